@@ -1,16 +1,23 @@
+#include "../src/engine/include/asyncsearch.hpp"
 #include "../src/engine/include/engine.hpp"
 #include "../src/engine/include/evaluation.hpp"
+#include "../src/engine/include/matesolver.hpp"
+#include "../src/engine/include/mcts.hpp"
+#include "../src/engine/include/memory.hpp"
 #include "../src/engine/include/movesgeneration.hpp"
 #include "../src/engine/include/search.hpp"
 #include "../src/engine/include/utils.hpp"
 #include <algorithm>
 #include <chrono>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 #define SEARCH_DEPTH    4
 #define QUIESCE_DEPTH   2
+#define PROGRESS_POLL   10 // ms between two looks at the progress of a search
 
 typedef unsigned long long u64;
 
@@ -158,6 +165,49 @@ std::string move2str(engine::Move &move) {
     return moveStr;
 }
 
+// search [<depth>] or search [depth <n>] [movetime <ms>] [nodes <n>] [wtime <ms>] [btime <ms>] [winc <ms>] [binc <ms>] [movestogo <n>] [infinite]
+engine::SearchLimits parseSearchLimits(std::vector<std::string> &splitCmd, size_t first) {
+    engine::SearchLimits limits;
+
+    if (splitCmd.size() == first) {
+        limits.depth = SEARCH_DEPTH;
+    } else if (splitCmd.size() == first + 1 && splitCmd[first] != "infinite") {
+        limits.depth = std::stoi(splitCmd[first]);
+    }
+
+    for (size_t i = first; i < splitCmd.size(); i++) {
+        if (splitCmd[i] == "infinite") {
+            limits.infinite = true;
+
+            continue;
+        }
+
+        if (i + 1 >= splitCmd.size()) {
+            break;
+        }
+
+        if (splitCmd[i] == "depth") {
+            limits.depth = std::stoi(splitCmd[++i]);
+        } else if (splitCmd[i] == "movetime") {
+            limits.moveTime = std::stoi(splitCmd[++i]);
+        } else if (splitCmd[i] == "nodes") {
+            limits.nodes = std::stoull(splitCmd[++i]);
+        } else if (splitCmd[i] == "wtime") {
+            limits.time[engine::Color::White] = std::stoi(splitCmd[++i]);
+        } else if (splitCmd[i] == "btime") {
+            limits.time[engine::Color::Black] = std::stoi(splitCmd[++i]);
+        } else if (splitCmd[i] == "winc") {
+            limits.increment[engine::Color::White] = std::stoi(splitCmd[++i]);
+        } else if (splitCmd[i] == "binc") {
+            limits.increment[engine::Color::Black] = std::stoi(splitCmd[++i]);
+        } else if (splitCmd[i] == "movestogo") {
+            limits.movesToGo = std::stoi(splitCmd[++i]);
+        }
+    }
+
+    return limits;
+}
+
 void showBoard(engine::Game &game) {
     std::vector<std::string> position = utils::split(game.getPositionFEN());
     size_t file = 0, rank = 8;
@@ -220,8 +270,59 @@ void showBoard(engine::Game &game) {
     std::cout << ((game.getActiveColor() == engine::Color::Black) ? "Black" : "White") << "'s turn\n" << std::endl;
 }
 
+void printSearchResult(engine::SearchHandle &search, std::chrono::milliseconds duration) {
+    engine::MoveValuation bestValuation = search.wait();
+    unsigned long long moveCount = search.getMoveCount();
+    float s = (float)duration.count() / 1000.f;
+
+    std::cout << "Visited " << moveCount << " nodes in " << duration.count() << "ms = " << s << "s => " << (float)moveCount / s << " N/s\n";
+    std::cout << "Depth reached : " << search.getCompletedDepth() << "\n";
+    std::cout << "Best move : " << move2str(bestValuation.first) << " (valuation = " << (float)bestValuation.second / 1000.f << ")\n" << std::endl;
+}
+
+// Show the progress of a search until it is over, then its result
+engine::MoveValuation followSearch(engine::SearchHandle &search, std::chrono::high_resolution_clock::time_point start) {
+    unsigned int shownDepth = 0;
+
+    while (!search.isFinished()) {
+        engine::SearchProgress progress = search.getProgress();
+
+        if (progress.depth > shownDepth) {
+            shownDepth = progress.depth;
+            std::cout << "\tdepth " << progress.depth << " nodes " << progress.nodes << " best move " << move2str(progress.bestMoveValuation.first)
+                      << " (valuation = " << (float)progress.bestMoveValuation.second / 1000.f << ")" << std::endl;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(PROGRESS_POLL));
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    printSearchResult(search, std::chrono::duration_cast<std::chrono::milliseconds>(end - start));
+
+    return search.wait();
+}
+
+// Stop the search started by go or ponder : it uses the threads, tables and search method, which must not change
+// while it runs, and there is only one search at a time
+void stopBackgroundSearch(std::unique_ptr<engine::SearchHandle> &backgroundSearch, bool &pondering) {
+    if (backgroundSearch) {
+        backgroundSearch->stop();
+        backgroundSearch.reset();
+
+        std::cout << "Background search stopped" << std::endl;
+    }
+
+    pondering = false;
+}
+
 int main() {
     engine::Game game;
+    std::unique_ptr<engine::SearchHandle> backgroundSearch; // started by go (until stop), or pondering
+    bool pondering = false;
+    engine::Move ponderMove; // reply expected from the opponent, searched in background
+    engine::SearchLimits ponderLimits; // limits of the search once the opponent has replied
+    auto backgroundStart = std::chrono::high_resolution_clock::now();
     std::string cmd;
     std::vector<std::string> splitCmd;
     std::vector<engine::Move> moveStack;
@@ -239,6 +340,8 @@ int main() {
         if (splitCmd[0] == "show") {
             showBoard(game);
         } else if (splitCmd[0] == "do") {
+            size_t playedMoves = 0;
+
             for (size_t m = 1; m < splitCmd.size(); m++) {
                 if (utils::idFromCaseName(splitCmd[m].substr(0, 2)) == -1 || utils::idFromCaseName(splitCmd[m].substr(2)) == -1) {
                     std::cout << "Invalid move : " << splitCmd[m] << "\n" << std::endl;
@@ -251,10 +354,34 @@ int main() {
 
                 moveStack.push_back(move);
                 saveStateStack.push_back(savedState);
+                playedMoves++;
+            }
+
+            if (pondering && playedMoves > 0) { // the opponent replied, search the move to play
+                auto start = std::chrono::high_resolution_clock::now();
+
+                pondering = false;
+
+                if (playedMoves == 1 && moveStack.back() == ponderMove) {
+                    std::cout << "Ponder hit" << std::endl;
+                    backgroundSearch->ponderHit(ponderLimits);
+                } else {
+                    std::cout << "Ponder miss" << std::endl;
+                    backgroundSearch.reset();
+                    backgroundSearch = std::make_unique<engine::SearchHandle>(game, ponderLimits);
+                }
+
+                followSearch(*backgroundSearch, start);
+                backgroundSearch.reset();
             }
         } else if (splitCmd[0] == "undo") {
             unsigned int n = 1;
 
+            if (pondering) {
+                backgroundSearch.reset();
+                pondering = false;
+            }
+
             if (splitCmd.size() > 1) {
                 n = std::stoi(splitCmd[1]);
             }
@@ -301,6 +428,11 @@ int main() {
                 }
             }
 
+            if (pondering) {
+                backgroundSearch.reset();
+                pondering = false;
+            }
+
             if (game.loadPosition(position) == -1) {
                 game.loadPosition(oldPosition);
             }
@@ -387,25 +519,16 @@ int main() {
             std::cout << "\n";
             std::cout << "Time : " << duration.count() << "ms => " << s << "s : " << (float)p / s << " N/s\n" << std::endl;
         } else if (splitCmd[0] == "search") {
-            unsigned int searchDepth = SEARCH_DEPTH;
+            engine::SearchLimits limits = parseSearchLimits(splitCmd, 1);
 
-            if (splitCmd.size() > 1) {
-                searchDepth = std::stoi(splitCmd[1]);
-            }
+            stopBackgroundSearch(backgroundSearch, pondering);
 
             std::cout << "With move ordering :" << std::endl;
             {
-                unsigned long long moveCount = 0;
                 auto start = std::chrono::high_resolution_clock::now();
+                engine::SearchHandle search(game, limits);
 
-                engine::MoveValuation bestValuation = engine::negaMax(game, searchDepth, searchDepth, moveCount, true);
-
-                auto end = std::chrono::high_resolution_clock::now();
-                auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-                float s = (float)duration.count() / 1000.f;
-
-                std::cout << "Visited " << moveCount << " nodes in " << duration.count() << "ms = " << s << "s => " << (float)moveCount / s << " N/s\n";
-                std::cout << "Best move : " << move2str(bestValuation.first) << " (valuation = " << (float)bestValuation.second / 1000.f << ")\n" << std::endl;
+                followSearch(search, start);
             }
             /*std::cout << "Without move ordering :" << std::endl;
             {
@@ -421,10 +544,193 @@ int main() {
                 std::cout << "Visited " << moveCount << " nodes in " << duration.count() << "ms = " << s << "s => " << (float)moveCount / s << " N/s\n";
                 std::cout << "Best move : " << move2str(bestValuation.first) << " (valuation = " << (float)bestValuation.second / 1000.f << ")\n" << std::endl;
             }*/
+        } else if (splitCmd[0] == "multipv" && splitCmd.size() > 1) {
+            engine::SearchLimits limits = parseSearchLimits(splitCmd, 2);
+            unsigned long long moveCount = 0;
+            unsigned int completedDepth = 0;
+
+            stopBackgroundSearch(backgroundSearch, pondering);
+
+            std::vector<engine::PVLine> variations = engine::multiPVSearch(game, limits, std::stoi(splitCmd[1]), moveCount, completedDepth);
+
+            std::cout << "Visited " << moveCount << " nodes, depth reached : " << completedDepth << "\n";
+
+            for (unsigned int i = 0; i < variations.size(); i++) {
+                std::cout << (i + 1) << ". (valuation = " << (float)variations[i].score / 1000.f << ")";
+
+                for (engine::Move &move : variations[i].moves) {
+                    std::cout << " " << move2str(move);
+                }
+
+                std::cout << "\n";
+            }
+
+            std::cout << std::endl;
+        } else if (splitCmd[0] == "mate" && splitCmd.size() > 1) {
+            unsigned long long maxNodes = 0, moveCount = 0;
+
+            if (splitCmd.size() > 3 && splitCmd[2] == "nodes") {
+                maxNodes = std::stoull(splitCmd[3]);
+            }
+
+            stopBackgroundSearch(backgroundSearch, pondering);
+
+            auto start = std::chrono::high_resolution_clock::now();
+
+            engine::MateResult result = engine::solveMate(game, std::stoi(splitCmd[1]), maxNodes, moveCount);
+
+            auto end = std::chrono::high_resolution_clock::now();
+            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+            std::cout << "Visited " << moveCount << " nodes in " << duration.count() << "ms\n";
+
+            if (result.status == engine::MateStatus::Proven) {
+                std::cout << "Mate in " << result.moves << " :";
+
+                for (engine::Move &move : result.line) {
+                    std::cout << " " << move2str(move);
+                }
+
+                std::cout << "\n" << std::endl;
+            } else if (result.status == engine::MateStatus::Disproven) {
+                std::cout << "No mate in " << splitCmd[1] << "\n" << std::endl;
+            } else {
+                std::cout << "Unknown (node limit reached)\n" << std::endl;
+            }
+        } else if (splitCmd[0] == "ponder") {
+            std::vector<engine::Move> legalMoves;
+
+            stopBackgroundSearch(backgroundSearch, pondering);
+            ponderLimits = parseSearchLimits(splitCmd, 1);
+            generateAllLegalMoves(game, legalMoves);
+
+            if (game.result(legalMoves) != engine::Result::Undecided) {
+                std::cout << "The game is over\n" << std::endl;
+
+                continue;
+            }
+
+            engine::MoveValuation bestValuation;
+            {
+                auto start = std::chrono::high_resolution_clock::now();
+                engine::SearchHandle search(game, ponderLimits);
+
+                bestValuation = followSearch(search, start);
+            }
+
+            std::vector<engine::Move> expectedMoves;
+
+            engine::principalVariation(game, bestValuation.first, 2, expectedMoves);
+
+            moveStack.push_back(bestValuation.first);
+            saveStateStack.push_back(game.doMove(bestValuation.first));
+
+            std::cout << "Played " << move2str(bestValuation.first) << std::endl;
+
+            if (expectedMoves.size() < 2) {
+                std::cout << "No reply to ponder on\n" << std::endl;
+
+                continue;
+            }
+
+            engine::Game ponderGame = game;
+            engine::SearchLimits limits = ponderLimits;
+
+            ponderMove = expectedMoves[1];
+            ponderGame.doMove(ponderMove);
+            limits.ponder = true;
+            backgroundSearch = std::make_unique<engine::SearchHandle>(ponderGame, limits);
+            pondering = true;
+
+            std::cout << "Pondering on " << move2str(ponderMove) << "\n" << std::endl;
+        } else if (splitCmd[0] == "go") {
+            engine::SearchLimits limits = parseSearchLimits(splitCmd, 1);
+
+            stopBackgroundSearch(backgroundSearch, pondering);
+            backgroundStart = std::chrono::high_resolution_clock::now();
+            backgroundSearch = std::make_unique<engine::SearchHandle>(game, limits);
+
+            std::cout << "Searching in background\n" << std::endl;
+        } else if (splitCmd[0] == "stop") {
+            if (backgroundSearch) {
+                backgroundSearch->stop();
+
+                auto end = std::chrono::high_resolution_clock::now();
+
+                printSearchResult(*backgroundSearch, std::chrono::duration_cast<std::chrono::milliseconds>(end - backgroundStart));
+                backgroundSearch.reset();
+                pondering = false;
+            }
+        } else if (splitCmd[0] == "progress") {
+            if (backgroundSearch) {
+                engine::SearchProgress progress = backgroundSearch->getProgress();
+
+                std::cout << (backgroundSearch->isFinished() ? "Finished" : "Searching") << " : depth " << progress.depth << " nodes " << progress.nodes
+                          << " best move " << move2str(progress.bestMoveValuation.first) << " (valuation = " << (float)progress.bestMoveValuation.second / 1000.f << ")\n" << std::endl;
+            }
         } else if (splitCmd[0] == "exit") {
             break;
         } else if (splitCmd[0] == "hash") {
             std::cout << "Position hash : " << game.getHash() << "\n" << std::endl;
+        } else if (splitCmd[0] == "ttable") {
+            engine::TTable &ttable = engine::getTranspositionTable();
+
+            if (splitCmd.size() > 1) {
+                stopBackgroundSearch(backgroundSearch, pondering);
+            }
+
+            if (splitCmd.size() > 2 && splitCmd[1] == "shared") {
+                if (ttable.openShared(splitCmd[2]) == 0) {
+                    std::cout << "Using shared transposition table " << ttable.getSharedName() << "\n" << std::endl;
+                }
+            } else if (splitCmd.size() > 1 && splitCmd[1] == "private") {
+                if (ttable.openPrivate() == 0) {
+                    std::cout << "Using private transposition table\n" << std::endl;
+                }
+            } else if (splitCmd.size() > 2 && splitCmd[1] == "remove") {
+                if (engine::TTable::removeShared(splitCmd[2]) == 0) {
+                    std::cout << "Shared transposition table removed\n" << std::endl;
+                }
+            } else {
+                std::cout << "Transposition table : " << (ttable.isShared() ? "shared " + ttable.getSharedName() : "private") << "\n" << std::endl;
+            }
+        } else if (splitCmd[0] == "memory") {
+            if (splitCmd.size() > 1) {
+                stopBackgroundSearch(backgroundSearch, pondering);
+                engine::setMemoryBudget((size_t)std::stoul(splitCmd[1]) << 20);
+                engine::clearMonteCarloTree(); // allocated again within the new budget by the next search
+                engine::clearMateTable();
+                engine::getTranspositionTable().resize();
+            }
+
+            std::cout << "Memory usage :\n";
+            engine::reportMemoryUsage(std::cout);
+            std::cout << std::endl;
+        } else if (splitCmd[0] == "method") {
+            if (splitCmd.size() > 1) {
+                stopBackgroundSearch(backgroundSearch, pondering);
+            }
+
+            if (splitCmd.size() > 1 && splitCmd[1] == "pvs") {
+                engine::setSearchMethod(engine::SearchMethod::PrincipalVariation);
+            } else if (splitCmd.size() > 1 && splitCmd[1] == "ybw") {
+                engine::setSearchMethod(engine::SearchMethod::YoungBrothersWait);
+            } else if (splitCmd.size() > 1 && splitCmd[1] == "mcts") {
+                engine::setSearchMethod(engine::SearchMethod::MonteCarlo);
+            } else if (splitCmd.size() > 1 && splitCmd[1] == "mtdf") {
+                engine::setSearchMethod(engine::SearchMethod::MTDf);
+            }
+
+            const char *methodNames[] = {"pvs", "ybw", "mcts", "mtdf"};
+
+            std::cout << "Search method : " << methodNames[engine::getSearchMethod()] << "\n" << std::endl;
+        } else if (splitCmd[0] == "threads") {
+            if (splitCmd.size() > 1) {
+                stopBackgroundSearch(backgroundSearch, pondering);
+                engine::setSearchThreads(std::stoul(splitCmd[1]));
+            }
+
+            std::cout << "Search threads : " << engine::getSearchThreads() << "\n" << std::endl;
         } else if (splitCmd[0] == "eval") {
             std::cout << "Position evaluation : " << engine::evaluate(game) << std::endl;
         } else if (splitCmd[0] == "help") {
@@ -435,6 +741,17 @@ int main() {
             std::cout << "\tundo [<n>] : undo <n> moves (1 by default)\n";
             std::cout << "\tmoves <square> : display the legal moves from the given <square>\n";
             std::cout << "\tsearch [<max depth>] : search the best move (<max depth> default is " << SEARCH_DEPTH << ")\n";
+            std::cout << "\tsearch [depth <n>] [movetime <ms>] [nodes <n>] [wtime <ms>] [btime <ms>] [winc <ms>] [binc <ms>] [movestogo <n>] [infinite] :\n";
+            std::cout << "\t\t\t\t\tsearch the best move within the given limits (time control, fixed time per move, nodes, depth)\n";
+            std::cout << "\tgo [<search limits>] : start a search in background (same limits as search), stopped by any other search\n";
+            std::cout << "\t\t\t\t\tand by the commands changing threads, method, memory or transposition table\n";
+            std::cout << "\tprogress : display depth, nodes and best move of the background search\n";
+            std::cout << "\tstop : stop the background search and display its best move\n";
+            std::cout << "\tponder [<search limits>] : search and play the best move, then search on the expected reply in background\n";
+            std::cout << "\t\t\t\t\tuntil the next do (same limits as search, they apply once the opponent has replied)\n";
+            std::cout << "\tmate <n> [nodes <n>] : prove or disprove a mate in <n> moves (or less) for the side to move, and show\n";
+            std::cout << "\t\t\t\t\tthe mating line\n";
+            std::cout << "\tmultipv <n> [<search limits>] : search the <n> best moves with their principal variations (same limits as search)\n";
             std::cout << "\tperft [divide] [<max depth>] [infos] : execute perft(<max depth>) with [divide] or additional [infos] (<max depth> default is " << 0 << ")\n";
             std::cout << "\tperft_legal [divide] [<max depth>] [infos] : execute perft_legal(<max depth>) with [divide] or additional [infos] (<max depth> default is " << 0 << ")\n";
             std::cout << "\t\t\t\t\tThe difference between perft and perft_legal is that perft_legal generate legal moves\n";
@@ -442,6 +759,15 @@ int main() {
             std::cout << "\t\t\t\t\tthen check if it lefts the king in check, and then undo the move, which adds a second\n";
             std::cout << "\t\t\t\t\tlayer of do/undo\n";
             std::cout << "\thash : display hash of current position\n";
+            std::cout << "\tttable [shared <name> | private | remove <name>] : show the transposition table in use, attach it to the\n";
+            std::cout << "\t\t\t\t\tshared memory segment <name> (shared by every engine process using it), go back to\n";
+            std::cout << "\t\t\t\t\ta private table, or remove the segment <name>\n";
+            std::cout << "\tmemory [<budget>] : display memory used by the engine tables (or set the memory budget to <budget> MB)\n";
+            std::cout << "\tmethod [pvs | ybw | mcts | mtdf] : display the search method (or select principal variation search, with\n";
+            std::cout << "\t\t\t\t\tlazy SMP on several threads, young brothers wait parallel search, Monte Carlo tree search,\n";
+            std::cout << "\t\t\t\t\tor MTD(f) zero window searches). Monte Carlo tree search turns a depth limit into\n";
+            std::cout << "\t\t\t\t\ta number of playouts\n";
+            std::cout << "\tthreads [<n>] : display the number of search threads (or search with <n> threads)\n";
             std::cout << "\teval : display evaluation of current position\n";
             std::cout << std::endl;
         }
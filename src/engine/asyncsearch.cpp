@@ -0,0 +1,83 @@
+#include "include/asyncsearch.hpp"
+#include "include/mcts.hpp"
+#include "include/threadpool.hpp"
+
+static engine::ThreadPool searchThread; // a single thread, running every search
+
+namespace engine {
+
+SearchHandle::SearchHandle(Game &game, SearchLimits &limits)
+    : game(game), limits(limits), result({Move(), MIN_SCORE}), moveCount(0), completedDepth(0), finished(false), stopRequested(false) {
+    resetSearchProgress(); // the previous search progress must not show until this one has started
+    cancelPonderHit();
+
+    if (::searchThread.getSize() == 0) {
+        ::searchThread.resize(1);
+    }
+
+    ::searchThread.start([this](unsigned int) {
+        this->run();
+    });
+}
+
+SearchHandle::~SearchHandle() {
+    this->stop();
+}
+
+void SearchHandle::run() {
+    setStopRequest(&this->stopRequested);
+
+    if (getSearchMethod() == SearchMethod::MonteCarlo) {
+        this->result = monteCarloSearch(this->game, this->limits, this->moveCount, this->completedDepth);
+    } else {
+        this->result = iterativeDeepening(this->game, this->limits, this->moveCount, this->completedDepth);
+    }
+
+    setStopRequest(nullptr);
+    this->finished = true;
+}
+
+// Stop the search and wait for it to be over. The request is latched first : a search which has not started
+// yet clears the stop flag when it starts, then finds the request.
+void SearchHandle::stop() {
+    this->stopRequested = true;
+    stopSearching();
+    this->wait();
+}
+
+// The opponent played the move this search was pondering on : it goes on, keeping its tree and transposition
+// table, under the given limits counted from now
+void SearchHandle::ponderHit(SearchLimits &limits) {
+    engine::ponderHit(limits);
+}
+
+// Wait for the search to reach its limits (or to be stopped), and return the best move it found
+MoveValuation SearchHandle::wait() {
+    ::searchThread.wait();
+
+    return this->result;
+}
+
+bool SearchHandle::isFinished() {
+    return this->finished.load();
+}
+
+// Depth and best move of the last completed iteration, and nodes searched so far
+SearchProgress SearchHandle::getProgress() {
+    if (this->finished.load()) {
+        return {this->completedDepth, this->moveCount, this->result};
+    }
+
+    return getSearchProgress();
+}
+
+// Only meaningful once the search is finished
+unsigned long long SearchHandle::getMoveCount() {
+    return this->moveCount;
+}
+
+unsigned int SearchHandle::getCompletedDepth() {
+    return this->completedDepth;
+}
+
+} // namespace engine
@@ -2,6 +2,7 @@
 #include "include/piece.hpp"
 #include "include/utils.hpp"
 #include "include/engine.hpp"
+#include <algorithm>
 #include <iostream>
 #include <vector>
 #include <string>
@@ -223,7 +224,7 @@ int Game::loadPosition(const std::string fen) {
 
     this->generate_hash();
     this->history.clear();
-    this->history.push_back({this->hash, Move()});
+    this->history.push_back({this->hash, Move(), {PieceType::None, Color::Black}});
 
     return 0;
 }
@@ -257,8 +258,8 @@ Result Game::result(std::vector<Move> &legalMoves) {
 bool Game::hasRepeated() {
     int repeats = 0;
 
-    for (const std::pair<Key, Move> &previousPosition : this->history) {
-        if (this->hash == previousPosition.first) {
+    for (const HistoryEntry &previousPosition : this->history) {
+        if (this->hash == previousPosition.hash) {
             repeats++;
         }
 
@@ -270,6 +271,134 @@ bool Game::hasRepeated() {
     return false;
 }
 
+// Cuckoo tables of the reversible moves (any non pawn piece moving between two squares it links on an empty board),
+// by the zobrist key they change : a position and an earlier one differing by such a key are one move apart.
+// Each key is in one of its two slots, at H1 or H2 of the key.
+struct CuckooMove {
+    unsigned int firstSquare;
+    unsigned int secondSquare;
+    int offset; // mailbox step from the first square to the second one
+};
+
+struct CuckooTables {
+    Key keys[CUCKOO_SIZE];
+    CuckooMove moves[CUCKOO_SIZE];
+
+    CuckooTables(Zobrist &zobristKeys);
+};
+
+static unsigned int cuckooH1(Key key) {
+    return key & (CUCKOO_SIZE - 1);
+}
+
+static unsigned int cuckooH2(Key key) {
+    return (key >> 16) & (CUCKOO_SIZE - 1);
+}
+
+CuckooTables::CuckooTables(Zobrist &zobristKeys) : keys(), moves() {
+    for (const auto &currentPieceTypeOffsets : pieceTypeOffsets) {
+        PieceType pieceType = currentPieceTypeOffsets.first;
+
+        if (pieceType == PieceType::Pawn) {
+            continue;
+        }
+
+        for (unsigned int color = Color::Black; color <= Color::White; color++) {
+            for (unsigned int firstSquare = 0; firstSquare < 64; firstSquare++) {
+                for (int offset : currentPieceTypeOffsets.second.first) {
+                    for (unsigned int mailboxId = mailbox8x8[firstSquare] + offset; mailbox10x12[mailboxId] != XX; mailboxId += offset) {
+                        unsigned int secondSquare = mailbox10x12[mailboxId];
+
+                        if (secondSquare > firstSquare) { // one entry for both directions
+                            Key key = zobristKeys.getKey(color * 384 + (pieceType - PieceType::Pawn) * 64 + firstSquare) ^
+                                      zobristKeys.getKey(color * 384 + (pieceType - PieceType::Pawn) * 64 + secondSquare) ^
+                                      zobristKeys.getKey(768);
+                            CuckooMove move = {firstSquare, secondSquare, offset};
+                            unsigned int slot = cuckooH1(key);
+
+                            // cuckoo insertion : the key takes its slot, the key it evicts goes to its other slot
+                            for (;;) {
+                                std::swap(this->keys[slot], key);
+                                std::swap(this->moves[slot], move);
+
+                                if (key == 0) {
+                                    break;
+                                }
+
+                                slot = (slot == cuckooH1(key)) ? cuckooH2(key) : cuckooH1(key);
+                            }
+                        }
+
+                        if (!currentPieceTypeOffsets.second.second) { // not sliding
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Whether the side to move can repeat an earlier position with its next move, making it a draw like hasRepeated().
+// Only the positions since the last irreversible move (or null move) can be repeated, every other one of them
+// has the side to move after that move.
+bool Game::hasUpcomingRepetition() {
+    static CuckooTables cuckooTables(this->zobristKeys); // the keys are the same for every game
+
+    unsigned int end = std::min((size_t)this->halfMoveNumber, this->history.size() - 1);
+
+    for (unsigned int i = 1; i <= end; i++) {
+        if (this->history[this->history.size() - i].move.getOriginSquare() >= 64) { // null move, the sides to move are swapped before
+            end = i - 1;
+
+            break;
+        }
+    }
+
+    for (unsigned int i = 3; i <= end; i += 2) {
+        Key earlierHash = this->history[this->history.size() - 1 - i].hash;
+        Key moveKey = this->hash ^ earlierHash;
+        unsigned int slot = cuckooH1(moveKey);
+
+        if (cuckooTables.keys[slot] != moveKey) {
+            slot = cuckooH2(moveKey);
+
+            if (cuckooTables.keys[slot] != moveKey) {
+                continue;
+            }
+        }
+
+        CuckooMove &cuckooMove = cuckooTables.moves[slot];
+        bool fromFirst = this->board[cuckooMove.firstSquare].pieceType != PieceType::None;
+        unsigned int originSquare = fromFirst ? cuckooMove.firstSquare : cuckooMove.secondSquare;
+        unsigned int targetSquare = fromFirst ? cuckooMove.secondSquare : cuckooMove.firstSquare;
+        int offset = fromFirst ? cuckooMove.offset : -cuckooMove.offset;
+        bool pathEmpty = this->board[targetSquare].pieceType == PieceType::None;
+
+        for (unsigned int mailboxId = mailbox8x8[originSquare] + offset; pathEmpty && mailboxId != mailbox8x8[targetSquare]; mailboxId += offset) {
+            pathEmpty = this->board[mailbox10x12[mailboxId]].pieceType == PieceType::None;
+        }
+
+        if (!pathEmpty || this->board[originSquare].color != this->activeColor) {
+            continue;
+        }
+
+        // the move must be legal, and change nothing else (castling rights)
+        Move move(originSquare, targetSquare, M_NONE, {PieceType::None, Color::Black});
+        Color activeColor = this->activeColor;
+        MoveSaveState savedState = this->doMove(move);
+        bool repeats = this->hash == earlierHash && !this->isAttackedBy(this->getKingSquare(activeColor), getOppositeColor(activeColor));
+
+        this->undoMove(move, savedState);
+
+        if (repeats) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 bool Game::isAttackedBy(unsigned int squareId, Color color) {
     int pawnSide = (color == Color::Black) ? 1 : -1;
     bool attacked = false;
@@ -417,7 +546,7 @@ MoveSaveState Game::doMove(Move &move) {
 
     this->switchActiveColor();
     this->update_hash(move, savedState);
-    this->history.push_back({this->hash, move});
+    this->history.push_back({this->hash, move, this->board[move.getTargetSquare()]});
 
     return savedState;
 }
@@ -460,6 +589,49 @@ void Game::undoMove(Move &move, MoveSaveState savedState) {
     }
 }
 
+// Pass the turn : only the side to move and the en passant square change
+MoveSaveState Game::doNullMove() {
+    MoveSaveState savedState = this->saveState();
+
+    if (this->enPassantTargetSquare < 64) {
+        this->hash ^= this->zobristKeys.getKey(773 + (this->enPassantTargetSquare % 8));
+    }
+
+    this->enPassantTargetSquare = 64;
+    this->halfMoveNumber++;
+
+    if (this->activeColor == Color::White) {
+        this->fullMoveNumber++;
+    }
+
+    this->switchActiveColor();
+    this->hash ^= this->zobristKeys.getKey(768); // change color side
+    this->history.push_back({this->hash, Move(), {PieceType::None, Color::Black}});
+
+    return savedState;
+}
+
+void Game::undoNullMove(MoveSaveState savedState) {
+    this->history.pop_back();
+    this->switchActiveColor();
+    this->restoreState(savedState);
+
+    this->hash ^= this->zobristKeys.getKey(768);
+
+    if (this->enPassantTargetSquare < 64) {
+        this->hash ^= this->zobristKeys.getKey(773 + (this->enPassantTargetSquare % 8));
+    }
+}
+
+// the first entry of the history is the loaded position, not a move
+bool Game::isLastMoveNull() {
+    return this->history.size() > 1 && this->history.back().move.getOriginSquare() >= 64;
+}
+
+std::vector<HistoryEntry> &Game::getHistory() {
+    return this->history;
+}
+
 void Game::generate_hash() {
     this->hash = 0;
 
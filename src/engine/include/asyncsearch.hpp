@@ -0,0 +1,45 @@
+#ifndef __ASYNCSEARCH_HPP__
+#define __ASYNCSEARCH_HPP__
+
+#include "engine.hpp"
+#include "search.hpp"
+#include "timemanagement.hpp"
+#include <atomic>
+
+namespace engine {
+
+// Iterative deepening search running on the search thread, on a copy of the game. Only one search can run at a time.
+// The search thread is kept between searches, so the history tables it learned go on to the next search.
+// Started with ponder limits, it searches on the opponent time until ponderHit() turns it into the real search.
+class SearchHandle {
+    private:
+        Game game;
+        SearchLimits limits;
+        MoveValuation result;
+        unsigned long long moveCount;
+        unsigned int completedDepth;
+        std::atomic<bool> finished;
+        std::atomic<bool> stopRequested; // latched, the search may not have started yet when it is stopped
+
+        void run();
+
+    public:
+        SearchHandle(Game &game, SearchLimits &limits);
+        ~SearchHandle();
+
+        SearchHandle(const SearchHandle &) = delete;
+        SearchHandle &operator=(const SearchHandle &) = delete;
+
+        void stop();
+        void ponderHit(SearchLimits &limits);
+        MoveValuation wait();
+        bool isFinished();
+
+        SearchProgress getProgress();
+        unsigned long long getMoveCount();
+        unsigned int getCompletedDepth();
+};
+
+} // namespace engine
+
+#endif
@@ -13,6 +13,8 @@
 
 #define XX 64
 
+#define CUCKOO_SIZE 8192 // cuckoo tables of the reversible moves, power of 2
+
 namespace engine {
 
 static const unsigned int mailbox10x12[120] = {
@@ -58,6 +60,14 @@ struct MoveSaveState {
     std::unordered_map<Color, unsigned int> kingSquare;
 };
 
+// A position reached during the game, with the move leading to it and the piece that move left on its target square
+// (no move and no piece for the loaded position and after a null move)
+struct HistoryEntry {
+    Key hash;
+    Move move;
+    Piece movedPiece;
+};
+
 enum Result {
     Draw,
     CheckMate,
@@ -70,7 +80,7 @@ class Game {
         Zobrist zobristKeys;
         Key hash;
 
-        std::vector<std::pair<Key, Move>> history;
+        std::vector<HistoryEntry> history;
         //std::unordered_map<Color, std::vector<unsigned int>> attacks;
         // std::vector<Move> legalMoves;
 
@@ -92,6 +102,7 @@ class Game {
 
         Result result(std::vector<Move> &legalMoves);
         bool hasRepeated();
+        bool hasUpcomingRepetition();
         bool isAttackedBy(unsigned int squareId, Color color);
 
         MoveSaveState saveState();
@@ -99,6 +110,10 @@ class Game {
 
         MoveSaveState doMove(Move &move);
         void undoMove(Move &move, MoveSaveState savedState);
+        MoveSaveState doNullMove();
+        void undoNullMove(MoveSaveState savedState);
+        bool isLastMoveNull();
+        std::vector<HistoryEntry> &getHistory();
 
         void update_hash(Move &move, MoveSaveState &savedState);
         // void hash_undo_move(Move &move, MoveSaveState &savedState);
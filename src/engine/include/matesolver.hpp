@@ -0,0 +1,29 @@
+#ifndef __MATESOLVER_HPP__
+#define __MATESOLVER_HPP__
+
+#include "engine.hpp"
+#include <vector>
+
+namespace engine {
+
+const unsigned int PN_INFINITY = 100000000;  // proof or disproof number of a solved position
+const unsigned int MAX_MATE_MOVES = 32;
+
+enum MateStatus {
+    Proven,     // the side to move mates within the given number of moves
+    Disproven,  // it can't
+    Unknown,    // node limit reached first
+};
+
+struct MateResult {
+    MateStatus status;
+    unsigned int moves;         // of the mate found, when proven
+    std::vector<Move> line;     // mating line, with the longest resistance the solver knows of
+};
+
+MateResult solveMate(Game &game, unsigned int maxMoves, unsigned long long maxNodes, unsigned long long &moveCount);
+void clearMateTable();
+
+} // namespace engine
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef __MCTS_HPP__
+#define __MCTS_HPP__
+
+#include "engine.hpp"
+#include "search.hpp"
+#include "timemanagement.hpp"
+
+namespace engine {
+
+// PUCT selection : a child is chosen by Q + MCTS_CPUCT * P * sqrt(N parent) / (1 + N child), where Q is its mean
+// value in [-1, 1] and P its prior. Unvisited children are valued as their parent, minus MCTS_FPU_REDUCTION
+const double MCTS_CPUCT = 1.5;
+const double MCTS_FPU_REDUCTION = 0.2;
+
+// leaves are valued by quiescence search, mapped to [-1, 1] by tanh(score / MCTS_VALUE_SCALE).
+// Priors are a softmax of the static exchange evaluation of the moves, with MCTS_PRIOR_TEMPERATURE
+const double MCTS_VALUE_SCALE = 400.0;
+const double MCTS_PRIOR_TEMPERATURE = 200.0;
+
+const unsigned int MCTS_REUSE_PLIES = 4;        // the tree of the previous search is kept if it was at most this many plies ago
+const unsigned int MCTS_PROGRESS_PLAYOUTS = 256; // playouts of the main thread between two progress updates
+
+// a depth limit has no meaning for the tree, which grows unevenly : it bounds the playouts instead, to
+// MCTS_DEPTH_PLAYOUTS << depth, as one more ply of alpha-beta search takes a few times more nodes
+const unsigned long long MCTS_DEPTH_PLAYOUTS = 256;
+const unsigned int MCTS_MAX_DEPTH_SHIFT = 32;
+
+MoveValuation monteCarloSearch(Game &game, SearchLimits &limits, unsigned long long &moveCount, unsigned int &completedDepth);
+void clearMonteCarloTree();
+
+} // namespace engine
+
+#endif
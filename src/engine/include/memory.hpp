@@ -0,0 +1,36 @@
+#ifndef __MEMORY_HPP__
+#define __MEMORY_HPP__
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+#define DEFAULT_MEMORY_BUDGET   (64ULL << 20) // bytes shared by every large engine table
+#define HUGE_PAGE_SIZE          (2ULL << 20)
+
+#define TTABLE_NAME "ttable"
+#define MCTS_TABLE_NAME "mcts"
+#define MATE_TABLE_NAME "mate"
+
+namespace engine {
+
+enum PageBacking {
+    HugePages,        // explicit 2 MB pages (MAP_HUGETLB)
+    TransparentHuge,  // normal pages, with the kernel asked to back them with huge pages (MADV_HUGEPAGE)
+    SmallPages,       // default pages
+};
+
+void setMemoryBudget(size_t budget);
+size_t getMemoryBudget();
+void setTableShare(const std::string &name, unsigned int percent);
+size_t getTableBudget(const std::string &name);
+
+void *allocateTable(const std::string &name, size_t size, int fd = -1);
+void freeTable(void *memory);
+
+size_t getMemoryUsage();
+void reportMemoryUsage(std::ostream &out);
+
+} // namespace engine
+
+#endif
@@ -46,6 +46,9 @@ class Move {
         bool isMate();
         unsigned int getCastlingSide();
         PieceType getPromotedPiece();
+
+        bool operator==(const Move &move) const;
+        bool operator!=(const Move &move) const;
 };
 
 } // namespace engine
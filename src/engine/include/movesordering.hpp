@@ -3,11 +3,45 @@
 
 #include "engine.hpp"
 #include "move.hpp"
+#include <vector>
+
+#define HASH_MOVE_SCORE     1000000
+#define CAPTURE_SCORE       100000  // winning and equal captures and promotions come before quiet moves
+#define LOSING_CAPTURE_SCORE -100000 // losing ones after them
+#define MVV_LVA_WEIGHT      2048    // captures are ranked by MVV-LVA, then by exchange value (below this weight)
+#define SEE_KING_VALUE      20000   // the king can only take last
+#define KILLER_MOVE_SCORE   90000   // first killer, the second one is just below
+#define COUNTER_MOVE_SCORE  89000   // refutation of the previous move, after the killers
+
+#define MAX_PLY             128     // plies with killer moves
+#define KILLER_SLOTS        2
+#define HISTORY_MAX         16384   // history values stay within [-HISTORY_MAX, HISTORY_MAX]
+#define HISTORY_MAX_BONUS   1200
+#define PIECE_KINDS         12      // [color][piece type] flattened
+#define CONTINUATION_PLIES  2       // continuation history follows the moves 1 and 2 plies before
 
 namespace engine {
 
+// What the search learned about quiet moves, each search thread has its own tables
+struct HistoryTables {
+    Move killers[MAX_PLY][KILLER_SLOTS];    // last quiet moves causing a beta cutoff at each ply
+    int butterfly[2][64][64];               // [color][origin square][target square]
+    Move counterMoves[PIECE_KINDS][64];     // [piece of the previous move][its target square]
+    // [previous piece][previous target square][piece][target square], for the move 1 and 2 plies before,
+    // on the heap as they are too big for thread local storage
+    std::vector<int> continuation[CONTINUATION_PLIES];
+
+    HistoryTables();
+};
+
+void ageHistoryTables();
+void updateHistoryTables(Game &game, Move &bestMove, std::vector<Move> &quietMoves, unsigned int ply, unsigned int depth);
+
+int quietHistoryScore(Game &game, Move &move);
+
+int staticExchangeEvaluation(Game &game, Move &move);
 int guessScore(Game &game, Move &move);
-void orderMoves(Game &game, std::vector<Move> &moves, std::vector<unsigned int> &orderedIndices);
+void orderMoves(Game &game, std::vector<Move> &moves, std::vector<unsigned int> &orderedIndices, Move hashMove = Move(), unsigned int ply = MAX_PLY);
 
 } // namespace engine
 
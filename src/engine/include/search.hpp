@@ -2,6 +2,11 @@
 #define __SEARCH_HPP__
 
 #include "engine.hpp"
+#include "threadpool.hpp"
+#include "transpositiontable.hpp"
+#include "timemanagement.hpp"
+#include <atomic>
+#include <vector>
 
 namespace engine {
 
@@ -9,11 +14,146 @@ const int MIN_SCORE = -32000;
 const int MAX_SCORE = +32000;
 const int NULL_SCORE = 0;
 
+// quiescence search : entries are stored in the transposition table at their own depth, below any full search,
+// and captures that can't bring the stand pat up to alpha even with DELTA_MARGIN more are skipped (delta pruning)
+const unsigned int QUIESCENCE_DEPTH = 0;
+const int DELTA_MARGIN = 200;
+
+// internal iterative deepening : minimal depth and depth reduction of the search looking for a hash move
+const unsigned int IID_DEPTH = 4;
+const unsigned int IID_REDUCTION = 2;
+
+// null move pruning : minimal depth, reduction R = NULL_MOVE_REDUCTION + depth / NULL_MOVE_REDUCTION_DIVISOR,
+// and depth from which a null move cutoff is verified by a reduced normal search
+const unsigned int NULL_MOVE_DEPTH = 2;
+const unsigned int NULL_MOVE_REDUCTION = 2;
+const unsigned int NULL_MOVE_REDUCTION_DIVISOR = 4;
+const unsigned int NULL_MOVE_VERIFICATION_DEPTH = 8;
+
+// pruning from the static evaluation near the leaves : reverse futility (static null move) fails high when the
+// evaluation beats beta by a margin per ply, razoring drops into quiescence when it is far below alpha, and
+// futility pruning skips quiet moves that can't bring it up to alpha
+const unsigned int REVERSE_FUTILITY_DEPTH = 6;
+const int REVERSE_FUTILITY_MARGIN = 90;
+const unsigned int RAZORING_DEPTH = 2;
+const int RAZORING_MARGIN = 300;
+const unsigned int FUTILITY_DEPTH = 3;
+const int FUTILITY_MARGIN = 120;
+
+// late move pruning : up to LMP_DEPTH, quiet moves after the first LMP_BASE + depth * depth ones are not searched
+const unsigned int LMP_DEPTH = 4;
+const unsigned int LMP_BASE = 3;
+
+// singular extensions : from SINGULAR_DEPTH, a hash move searched at least SINGULAR_DEPTH_MARGIN plies
+// shallower is extended if every other move fails low against its score - SINGULAR_MARGIN * depth
+// in a search of half depth. Extensions (check or singular) are 1 ply at most per ply, and stop at
+// twice the iteration depth
+const unsigned int SINGULAR_DEPTH = 6;
+const unsigned int SINGULAR_DEPTH_MARGIN = 3;
+const int SINGULAR_MARGIN = 2;
+
+// ProbCut : at deep non PV nodes, a capture beating beta + PROBCUT_MARGIN in a search reduced by PROBCUT_REDUCTION
+// plies would very likely beat beta at full depth. Can be tuned at compile time (-DPROBCUT_MARGIN=...)
+#ifndef PROBCUT_DEPTH
+#define PROBCUT_DEPTH 5
+#endif
+#ifndef PROBCUT_REDUCTION
+#define PROBCUT_REDUCTION 4
+#endif
+#ifndef PROBCUT_MARGIN
+#define PROBCUT_MARGIN 200
+#endif
+
+static_assert(PROBCUT_DEPTH > PROBCUT_REDUCTION, "the reduced depth of ProbCut searches would wrap around");
+
+// late move reductions : reduction = LMR_BASE + ln(depth) * ln(move number) / LMR_DIVISOR, from LMR_DEPTH,
+// for quiet moves from the LMR_MOVE_NUMBER-th one (LMR_PV_MOVE_NUMBER-th at PV nodes)
+const unsigned int LMR_DEPTH = 3;
+const unsigned int LMR_MOVE_NUMBER = 2;
+const unsigned int LMR_PV_MOVE_NUMBER = 4;
+const unsigned int LMR_MAX_MOVES = 64;
+const double LMR_BASE = 0.5;
+const double LMR_DIVISOR = 2.25;
+const int LMR_HISTORY_DIVISOR = 8192; // one ply of reduction less (more) per LMR_HISTORY_DIVISOR of history score above (below) 0
+
+// aspiration windows : half width of the first window around the previous score, and first depth using it
+const int ASPIRATION_WINDOW = 35;
+const unsigned int ASPIRATION_DEPTH = 4;
+
+const unsigned int MAX_DEPTH = 64;
+const unsigned int PV_MAX_PLY = 3 * MAX_DEPTH; // plies of the principal variation, extensions included
+const int MATE_BOUND = MAX_SCORE - 2 * (int)MAX_DEPTH; // scores beyond are mates, extended plies stay under 2 * MAX_DEPTH
+const unsigned long long NODES_BETWEEN_POLLS = 1024; // nodes searched between two checks of the time limit
+const unsigned int MAX_SEARCH_THREADS = 64;
+const unsigned int YBW_SPLIT_DEPTH = 4; // young brothers wait : nodes below this depth are never split
+const unsigned int YBW_WAIT_POLL_TIME = 5; // ms between two checks of the time limit while waiting for the helpers of a split point
+
+// time management of iterative deepening
+const unsigned int EASY_MOVE_DEPTH = 5;         // a move can be found clearly best from this depth
+const int EASY_MOVE_MARGIN = 150;               // by this much over the second best move
+const unsigned int EASY_MOVE_TIME_DIVISOR = 4;  // after having used this fraction of the soft limit
+const unsigned int STABLE_ITERATIONS = 3;       // iterations with the same best move before saving time
+const double STABLE_TIME_FACTOR = 0.6;
+const double UNSTABLE_TIME_FACTOR = 1.5;        // when the best move just changed
+const unsigned long long MIN_BRANCHING_FACTOR = 2; // bounds of the estimated growth of the next iteration time
+const unsigned long long MAX_BRANCHING_FACTOR = 8;
+
+enum SearchMethod {
+    PrincipalVariation, // alphabeta() with principal variation search, lazy SMP with several threads
+    YoungBrothersWait,  // alphabeta() sharing the moves of its nodes between threads at split points
+    MonteCarlo,         // monteCarloSearch(), PUCT tree search with every thread on the same tree
+    MTDf,               // alphabeta() driven by zero window searches converging on the score, lazy SMP with several threads
+};
+
+struct RootMove {
+    Move move;
+    int score;
+    int previousScore;
+    std::vector<Move> pv; // principal variation, starting with the move, of its last search with an exact score or a lower bound
+};
+
 typedef std::pair<Move, int> MoveValuation;
 
+struct SearchProgress {
+    unsigned int depth;                 // last completed iteration
+    unsigned long long nodes;
+    MoveValuation bestMoveValuation;    // best move of the last completed iteration
+};
+
+struct PVLine {
+    int score;
+    std::vector<Move> moves;
+};
+
+TTable &getTranspositionTable();
+int scoreToTTable(int score, unsigned int ply);
+int scoreFromTTable(int score, unsigned int ply);
+
 int quiesceSearch(Game &game, int alpha, int beta, unsigned long long &moveCount, bool orderingMoves = true);
-int alphabeta(Game &game, unsigned int maxDepth, unsigned int depth, int alpha, int beta, unsigned long long &moveCount, bool orderingMoves = true);
+int alphabeta(Game &game, unsigned int maxDepth, unsigned int depth, int alpha, int beta, unsigned long long &moveCount, bool orderingMoves = true, bool cutNode = false, Move excludedMove = Move());
+MoveValuation searchRoot(Game &game, std::vector<RootMove> &rootMoves, unsigned int maxDepth, unsigned int depth, int alpha, int beta, unsigned long long &moveCount, bool orderingMoves = true, bool storingEntry = true);
 MoveValuation negaMax(Game &game, unsigned int maxDepth, unsigned int depth, unsigned long long &moveCount, bool orderingMoves = true);
+MoveValuation iterativeDeepening(Game &game, SearchLimits &limits, unsigned long long &moveCount, unsigned int &completedDepth);
+void principalVariation(Game &game, Move firstMove, unsigned int maxLength, std::vector<Move> &moves);
+std::vector<PVLine> multiPVSearch(Game &game, SearchLimits &limits, unsigned int lines, unsigned long long &moveCount, unsigned int &completedDepth);
+
+void stopSearching();
+void setStopRequest(std::atomic<bool> *request);
+void resetSearchProgress();
+void ponderHit(SearchLimits &limits);
+void cancelPonderHit();
+SearchProgress getSearchProgress();
+
+// limits, stop flag, threads and progress of the running search, for the searchers beside alpha-beta
+ThreadPool &getSearchThreadPool();
+void beginSearch(SearchLimits &limits, Color color);
+bool searchLimitReached(unsigned long long moveCount);
+void publishSearchProgress(SearchProgress &progress);
+
+void setSearchMethod(SearchMethod method);
+SearchMethod getSearchMethod();
+void setSearchThreads(unsigned int threads);
+unsigned int getSearchThreads();
 
 } // namespace engine
 
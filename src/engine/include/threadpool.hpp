@@ -0,0 +1,47 @@
+#ifndef __THREADPOOL_HPP__
+#define __THREADPOOL_HPP__
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace engine {
+
+// Threads kept alive between searches. A job is run once by every thread, with the index of the thread
+class ThreadPool {
+    private:
+        std::vector<std::thread> threads;
+        std::mutex mutex;
+        std::condition_variable jobReady;
+        std::condition_variable jobDone;
+        std::condition_variable workReady; // idle threads of a job waiting for it to have more work
+        std::function<void(unsigned int)> job;
+        unsigned long long generation; // incremented for every job, so each thread runs it only once
+        unsigned int running;          // threads still running the current job
+        bool quit;
+
+        void workerLoop(unsigned int index, unsigned long long lastGeneration);
+        void stopThreads();
+
+    public:
+        ThreadPool();
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        void resize(unsigned int size);
+        unsigned int getSize();
+
+        void start(std::function<void(unsigned int)> job);
+        void wait();
+
+        void waitForWork(std::unique_lock<std::mutex> &lock, std::function<bool()> ready);
+        void notifyWork();
+};
+
+} // namespace engine
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef __TIMEMANAGEMENT_HPP__
+#define __TIMEMANAGEMENT_HPP__
+
+#include "piece.hpp"
+#include <chrono>
+
+#define MOVE_OVERHEAD           30  // ms kept for communication/GUI latency
+#define DEFAULT_MOVES_TO_GO     30  // moves left in the game when the time control doesn't tell
+#define HARD_LIMIT_FACTOR       4   // the hard limit is a few soft limits, but never more than a fraction of the clock
+#define HARD_LIMIT_CLOCK_RATIO  3   // at most 1/3 of the remaining time on a single move
+
+namespace engine {
+
+struct SearchLimits {
+    unsigned int depth = 0;             // maximal depth (0 = no limit)
+    unsigned long long nodes = 0;       // maximal number of nodes (0 = no limit)
+    unsigned int moveTime = 0;          // fixed time for this move, in ms (0 = none)
+    unsigned int time[2] = {0, 0};      // remaining time of each side (indexed by Color), in ms (0 = none)
+    unsigned int increment[2] = {0, 0}; // increment of each side, in ms
+    unsigned int movesToGo = 0;         // moves until next time control (0 = sudden death)
+    bool infinite = false;              // search until stopped
+    bool ponder = false;                // search on the opponent time, as infinite until a ponder hit
+};
+
+class TimeManager {
+    private:
+        std::chrono::steady_clock::time_point start;
+        bool timed;
+        unsigned long long softLimit; // don't start a new iteration past this (ms)
+        unsigned long long hardLimit; // abort the current iteration past this (ms)
+        unsigned long long optimalLimit; // soft limit before any stability adjustment
+
+    public:
+        TimeManager();
+
+        void init(SearchLimits &limits, Color color);
+        void adjust(double factor);
+
+        bool isTimed();
+        unsigned long long elapsed();
+        unsigned long long getSoftLimit();
+        unsigned long long getHardLimit();
+        bool softLimitReached();
+        bool hardLimitReached();
+};
+
+} // namespace engine
+
+#endif
@@ -3,8 +3,9 @@
 
 #include "move.hpp"
 #include "zobrist.hpp"
-
-#define TTABLE_SIZE 1000000
+#include <atomic>
+#include <cstddef>
+#include <string>
 
 namespace engine {
 
@@ -22,12 +23,39 @@ struct TTEntry {
     Key hash;
 };
 
+// An entry as stored in the table : the move, depth, type and valuation are packed in data,
+// and check holds hash ^ data, so a slot torn by concurrent writers (threads or processes) fails
+// the hash comparison instead of returning mixed up values
+struct TTSlot {
+    std::atomic<Key> check;
+    std::atomic<unsigned long long> data;
+};
+
 class TTable {
     private:
-        TTEntry table[TTABLE_SIZE];
-    
+        TTSlot *table;
+        size_t size; // number of slots, power of 2
+        std::string sharedName; // empty if the table is private to this process
+
+        void computeSize();
+        int mapPrivate();
+        void unmap();
+
     public:
-        TTable() = default;
+        TTable();
+        ~TTable();
+
+        TTable(const TTable &) = delete;
+        TTable &operator=(const TTable &) = delete;
+
+        int openShared(const std::string &name);
+        int openPrivate();
+        int resize();
+        static int removeShared(const std::string &name);
+
+        bool isShared();
+        size_t getSize();
+        const std::string &getSharedName();
 
         TTEntry getEntry(Key &key);
         void addEntry(Key &key, Move &move, unsigned int depth, int valuation, int alpha, int beta);
@@ -35,4 +63,4 @@ class TTable {
 
 } // namespace engine
 
-#endif
\ No newline at end of file
+#endif
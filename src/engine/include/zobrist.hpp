@@ -12,7 +12,7 @@ class Zobrist {
         // then castling rights : 4
         // then file for valid en passant square = 8
         // Total = 768 + 1 + 4 + 8 = 781
-        bool initialized;
+        bool initialized = false;
         Key keys[781];
     
     public:
@@ -0,0 +1,447 @@
+#include "include/matesolver.hpp"
+#include "include/memory.hpp"
+#include "include/movesgeneration.hpp"
+#include <algorithm>
+#include <iostream>
+
+#define BUCKET_ENTRIES 4 // entries of a position for different plies left share its bucket
+#define PN_EPSILON_DIVISOR 4 // 1 + epsilon trick : a child is searched until it is 1 + 1/4 times worse than the second best
+
+// Proof and disproof numbers of a position for a given number of plies left. A mate within some plies is one within
+// more plies as well, and no mate within some plies means none within less, so solved entries also answer for other
+// plies left (of the same parity, which tells the side to move is the attacker). Proven entries are stored with the
+// plies of their mate.
+struct MateEntry {
+    engine::Key hash;
+    unsigned int plies;
+    unsigned int proof;
+    unsigned int disproof;
+    unsigned long long work;    // nodes searched to get the numbers
+};
+
+struct ProofNumbers {
+    unsigned int proof;
+    unsigned int disproof;
+    unsigned int distance;      // plies to the mate, when proven
+    bool pathDependent;         // disproven by a repetition or the fifty-move rule on the path, not by the position itself
+};
+
+struct ChildNode {
+    engine::Move move;
+    ProofNumbers numbers;
+};
+
+struct SolverState {
+    unsigned long long moveCount;
+    unsigned long long maxNodes;
+    bool stopped;
+};
+
+static MateEntry *mateTable = nullptr;
+static size_t mateTableSize = 0; // number of buckets, power of 2
+
+static bool initMateTable() {
+    size_t budget = engine::getTableBudget(MATE_TABLE_NAME);
+    size_t size = 0;
+
+    while ((size == 0 ? 1 : size * 2) * BUCKET_ENTRIES * sizeof(MateEntry) <= budget) {
+        size = (size == 0) ? 1 : size * 2;
+    }
+
+    if (::mateTable != nullptr && size == ::mateTableSize) {
+        return true;
+    }
+
+    engine::clearMateTable();
+
+    if (size == 0) {
+        std::cerr << "[ERROR] No memory budget for the mate solver table" << std::endl;
+
+        return false;
+    }
+
+    ::mateTable = static_cast<MateEntry *>(engine::allocateTable(MATE_TABLE_NAME, size * BUCKET_ENTRIES * sizeof(MateEntry)));
+
+    if (::mateTable == nullptr) {
+        std::cerr << "[ERROR] Could not allocate mate solver table" << std::endl;
+
+        return false;
+    }
+
+    ::mateTableSize = size;
+
+    return true;
+}
+
+static bool isProven(const ProofNumbers &numbers) {
+    return numbers.proof == 0;
+}
+
+static bool isDisproven(const ProofNumbers &numbers) {
+    return numbers.disproof == 0;
+}
+
+// Entry answering for the position with the given plies left : a solved one if there is, else the one for these plies
+static MateEntry *findEntry(engine::Game &game, unsigned int plies) {
+    MateEntry *bucket = ::mateTable + (game.getHash() & (::mateTableSize - 1)) * BUCKET_ENTRIES;
+    MateEntry *found = nullptr;
+
+    for (unsigned int i = 0; i < BUCKET_ENTRIES; i++) {
+        MateEntry &entry = bucket[i];
+
+        if (entry.hash != game.getHash() || entry.plies % 2 != plies % 2 || (entry.proof == 0 && entry.disproof == 0)) {
+            continue;
+        }
+
+        if ((entry.proof == 0 && entry.plies <= plies) || (entry.disproof == 0 && entry.plies >= plies)) {
+            return &entry;
+        }
+
+        if (entry.plies == plies) {
+            found = &entry;
+        }
+    }
+
+    return found;
+}
+
+// Disproofs depending on the path are kept out of the table, the position may be reached by another one
+static void storeEntry(engine::Game &game, unsigned int plies, const ProofNumbers &numbers, unsigned long long work) {
+    MateEntry *bucket = ::mateTable + (game.getHash() & (::mateTableSize - 1)) * BUCKET_ENTRIES;
+    MateEntry *replaced = &bucket[0];
+
+    if (numbers.pathDependent) {
+        return;
+    }
+
+    if (::isProven(numbers)) {
+        plies = numbers.distance;
+    }
+
+    for (unsigned int i = 0; i < BUCKET_ENTRIES; i++) {
+        if (bucket[i].hash == game.getHash() && bucket[i].plies == plies) {
+            replaced = &bucket[i];
+
+            break;
+        }
+
+        if (bucket[i].work < replaced->work) {
+            replaced = &bucket[i];
+        }
+    }
+
+    *replaced = {game.getHash(), plies, numbers.proof, numbers.disproof, work};
+}
+
+static unsigned int addNumbers(unsigned int a, unsigned int b) {
+    return std::min(a + b, engine::PN_INFINITY);
+}
+
+// Numbers of a position which is over, {1, 1} if it isn't
+static ProofNumbers terminalNumbers(engine::Game &game, unsigned int plies, std::vector<engine::Move> &legalMoves) {
+    engine::Result result = game.result(legalMoves);
+
+    if (result == engine::Result::Undecided) {
+        return {1, 1, 0, false};
+    }
+
+    if (result == engine::Result::CheckMate && plies % 2 == 0) {
+        return {0, engine::PN_INFINITY, 0, false};
+    }
+
+    // with moves left, the draw is the fifty-move rule, the half move clock isn't part of the position
+    return {engine::PN_INFINITY, 0, 0, !legalMoves.empty()};
+}
+
+// Numbers of a position before it is searched : from the table, solved for the defender when it has no move or no
+// plies left, else its number of moves as proof number (a defender with few moves is close to being mated), so that
+// the search goes to the most constrained lines first. Generating the moves of the attacker would cost more than
+// the ordering gains, its positions are solved when they get searched.
+static ProofNumbers initialNumbers(engine::Game &game, unsigned int plies) {
+    bool attackerToMove = (plies % 2 == 1);
+
+    if (game.hasRepeated()) {
+        return {engine::PN_INFINITY, 0, 0, true};
+    }
+
+    // no plies left, only a checking move can have mated
+    if (plies == 0 && !game.isAttackedBy(game.getKingSquare(game.getActiveColor()), engine::getOppositeColor(game.getActiveColor()))) {
+        return {engine::PN_INFINITY, 0, 0, false};
+    }
+
+    MateEntry *entry = ::findEntry(game, plies);
+
+    if (entry != nullptr) {
+        return {entry->proof, entry->disproof, entry->plies, false};
+    }
+
+    if (attackerToMove) {
+        return {1, 1, 0, false};
+    }
+
+    std::vector<engine::Move> legalMoves;
+
+    engine::generateAllLegalMoves(game, legalMoves);
+
+    ProofNumbers numbers = ::terminalNumbers(game, plies, legalMoves);
+
+    if (::isProven(numbers) || ::isDisproven(numbers)) {
+        ::storeEntry(game, plies, numbers, 0);
+
+        return numbers;
+    }
+
+    if (plies == 0) { // not mated
+        numbers = {engine::PN_INFINITY, 0, 0, false};
+        ::storeEntry(game, plies, numbers, 0);
+
+        return numbers;
+    }
+
+    return {(unsigned int)legalMoves.size(), 1, 0, false};
+}
+
+// Multiple iterative deepening of depth-first proof-number search : the most proving child is searched until the
+// numbers of the node reach one of the thresholds, the child being given thresholds that make it return as soon as
+// another child becomes the most proving one. The attacker mates if one of its moves mates (OR node), the
+// defender is mated if all of its moves are (AND node).
+static void multipleIterativeDeepening(engine::Game &game, unsigned int plies, unsigned int proofThreshold, unsigned int disproofThreshold,
+                                       ProofNumbers &numbers, SolverState &state) {
+    bool attackerToMove = (plies % 2 == 1);
+    unsigned long long startCount = state.moveCount;
+    std::vector<engine::Move> legalMoves;
+    std::vector<ChildNode> children;
+
+    engine::generateAllLegalMoves(game, legalMoves);
+
+    numbers = ::terminalNumbers(game, plies, legalMoves);
+
+    if (::isProven(numbers) || ::isDisproven(numbers)) {
+        ::storeEntry(game, plies, numbers, 0);
+
+        return;
+    }
+
+    for (engine::Move &move : legalMoves) {
+        engine::MoveSaveState savedState = game.doMove(move);
+
+        children.push_back({move, ::initialNumbers(game, plies - 1)});
+        game.undoMove(move, savedState);
+        state.moveCount++;
+    }
+
+    for (;;) {
+        unsigned int best = 0, secondBest = engine::PN_INFINITY;
+        bool dependentDisproof = false, ownDisproof = false;
+
+        // the numbers the side to move minimizes are compared, the others summed
+        numbers = attackerToMove ? ProofNumbers{engine::PN_INFINITY, 0, engine::PN_INFINITY, false} : ProofNumbers{0, engine::PN_INFINITY, 0, false};
+
+        for (unsigned int i = 0; i < children.size(); i++) {
+            ProofNumbers &childNumbers = children[i].numbers;
+            unsigned int minimized = attackerToMove ? childNumbers.proof : childNumbers.disproof;
+            unsigned int bestMinimized = attackerToMove ? children[best].numbers.proof : children[best].numbers.disproof;
+
+            if (attackerToMove) {
+                numbers.proof = std::min(numbers.proof, childNumbers.proof);
+                numbers.disproof = ::addNumbers(numbers.disproof, childNumbers.disproof);
+            } else {
+                numbers.proof = ::addNumbers(numbers.proof, childNumbers.proof);
+                numbers.disproof = std::min(numbers.disproof, childNumbers.disproof);
+            }
+
+            // the attacker takes its quickest mate, the defender the longest
+            if (::isProven(childNumbers)) {
+                numbers.distance = attackerToMove ? std::min(numbers.distance, childNumbers.distance + 1) : std::max(numbers.distance, childNumbers.distance + 1);
+            }
+
+            if (::isDisproven(childNumbers)) {
+                dependentDisproof |= childNumbers.pathDependent;
+                ownDisproof |= !childNumbers.pathDependent;
+            }
+
+            if (i > 0 && minimized < bestMinimized) {
+                secondBest = bestMinimized;
+                best = i;
+            } else if (i > 0) {
+                secondBest = std::min(secondBest, minimized);
+            }
+        }
+
+        // all the moves of the attacker are disproven, one of the defender is enough
+        numbers.pathDependent = ::isDisproven(numbers) && (attackerToMove ? dependentDisproof : !ownDisproof);
+
+        if (numbers.proof >= proofThreshold || numbers.disproof >= disproofThreshold) {
+            break;
+        }
+
+        if (state.maxNodes > 0 && state.moveCount >= state.maxNodes) {
+            state.stopped = true;
+
+            break;
+        }
+
+        ChildNode &child = children[best];
+        unsigned int childProofThreshold, childDisproofThreshold;
+
+        if (attackerToMove) {
+            childProofThreshold = std::min(proofThreshold, ::addNumbers(secondBest + secondBest / PN_EPSILON_DIVISOR, 1));
+            childDisproofThreshold = ::addNumbers(disproofThreshold - numbers.disproof, child.numbers.disproof);
+        } else {
+            childProofThreshold = ::addNumbers(proofThreshold - numbers.proof, child.numbers.proof);
+            childDisproofThreshold = std::min(disproofThreshold, ::addNumbers(secondBest + secondBest / PN_EPSILON_DIVISOR, 1));
+        }
+
+        engine::MoveSaveState savedState = game.doMove(child.move);
+
+        state.moveCount++;
+        ::multipleIterativeDeepening(game, plies - 1, childProofThreshold, childDisproofThreshold, child.numbers, state);
+        game.undoMove(child.move, savedState);
+
+        if (state.stopped) {
+            break;
+        }
+    }
+
+    ::storeEntry(game, plies, numbers, state.moveCount - startCount);
+}
+
+// Numbers of a position searched until it is solved, from the table when it is already
+static ProofNumbers solvePosition(engine::Game &game, unsigned int plies, SolverState &state) {
+    ProofNumbers numbers = ::initialNumbers(game, plies);
+
+    if (!::isProven(numbers) && !::isDisproven(numbers)) {
+        ::multipleIterativeDeepening(game, plies, engine::PN_INFINITY, engine::PN_INFINITY, numbers, state);
+    }
+
+    return numbers;
+}
+
+// Follow a proven mate through the proof in the table, the attacker playing its quickest mate and the defender its
+// longest resistance. Only the positions whose entries were replaced meanwhile are solved again.
+static void mateLine(engine::Game &game, unsigned int plies, std::vector<engine::Move> &line, SolverState &state) {
+    std::vector<engine::MoveSaveState> savedStates;
+
+    while (plies > 0 && !state.stopped) {
+        bool attackerToMove = (plies % 2 == 1);
+        std::vector<engine::Move> legalMoves;
+        std::vector<engine::Move> unknownMoves; // not proven in the table
+        engine::Move chosen;
+        unsigned int chosenPlies = 0;
+        bool found = false;
+
+        engine::generateAllLegalMoves(game, legalMoves);
+
+        for (engine::Move &move : legalMoves) {
+            engine::MoveSaveState savedState = game.doMove(move);
+            ProofNumbers numbers = ::initialNumbers(game, plies - 1);
+
+            game.undoMove(move, savedState);
+
+            if (!::isProven(numbers)) {
+                unknownMoves.push_back(move);
+            } else if (!found || (attackerToMove ? numbers.distance < chosenPlies : numbers.distance > chosenPlies)) {
+                chosen = move;
+                chosenPlies = numbers.distance;
+                found = true;
+            }
+        }
+
+        // the attacker needs one mating move, the defender's moves all lead to a mate
+        for (engine::Move &move : unknownMoves) {
+            if (attackerToMove && found) {
+                break;
+            }
+
+            engine::MoveSaveState savedState = game.doMove(move);
+            ProofNumbers numbers = ::solvePosition(game, plies - 1, state);
+
+            game.undoMove(move, savedState);
+
+            if (::isProven(numbers) && (!found || attackerToMove || numbers.distance > chosenPlies)) {
+                chosen = move;
+                chosenPlies = numbers.distance;
+                found = true;
+            }
+        }
+
+        if (!found) {
+            break;
+        }
+
+        line.push_back(chosen);
+        savedStates.push_back(game.doMove(line.back()));
+        plies = chosenPlies;
+    }
+
+    for (unsigned int i = savedStates.size(); i > 0; i--) {
+        game.undoMove(line[i - 1], savedStates[i - 1]);
+    }
+}
+
+namespace engine {
+
+// Prove or disprove a mate of the side to move within maxMoves moves, with df-pn. A proof is usually found quickly,
+// unlike a disproof, so the mate found is then shortened with as many nodes as it took to prove it : a shorter one
+// may still exist. maxNodes = 0 means no node limit.
+MateResult solveMate(Game &game, unsigned int maxMoves, unsigned long long maxNodes, unsigned long long &moveCount) {
+    MateResult result = {MateStatus::Disproven, 0, {}};
+    SolverState state = {0, maxNodes, false};
+
+    maxMoves = std::min(maxMoves, MAX_MATE_MOVES);
+
+    if (maxMoves == 0) {
+        return result;
+    }
+
+    if (!::initMateTable()) {
+        result.status = MateStatus::Unknown;
+
+        return result;
+    }
+
+    ProofNumbers numbers = ::solvePosition(game, 2 * maxMoves - 1, state);
+
+    if (state.stopped) {
+        result.status = MateStatus::Unknown;
+    } else if (::isProven(numbers)) {
+        unsigned long long shorteningNodes = state.moveCount;
+
+        if (maxNodes > 0) {
+            shorteningNodes = std::min(shorteningNodes, maxNodes - std::min(maxNodes, state.moveCount));
+        }
+
+        SolverState shortening = {0, shorteningNodes, shorteningNodes == 0};
+
+        while (numbers.distance >= 3 && !shortening.stopped) {
+            ProofNumbers shorter = ::solvePosition(game, numbers.distance - 2, shortening);
+
+            if (!::isProven(shorter)) {
+                break;
+            }
+
+            numbers = shorter;
+        }
+
+        state.moveCount += shortening.moveCount;
+
+        result.status = MateStatus::Proven;
+        result.moves = (numbers.distance + 1) / 2;
+        ::mateLine(game, numbers.distance, result.line, state);
+    }
+
+    moveCount += state.moveCount;
+
+    return result;
+}
+
+void clearMateTable() {
+    if (::mateTable != nullptr) {
+        freeTable(::mateTable);
+    }
+
+    ::mateTable = nullptr;
+    ::mateTableSize = 0;
+}
+
+} // namespace engine
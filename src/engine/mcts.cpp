@@ -0,0 +1,490 @@
+#include "include/mcts.hpp"
+#include "include/memory.hpp"
+#include "include/movesgeneration.hpp"
+#include "include/movesordering.hpp"
+#include "include/threadpool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <iostream>
+#include <new>
+#include <vector>
+
+#define VALUE_UNIT  (1LL << 20) // node values are summed atomically in fixed point
+#define MAX_VALUE   0.999       // bound of the mean values turned back into scores
+#define NO_NODE     UINT_MAX
+
+enum NodeState : unsigned char {
+    Unexpanded,
+    Expanding,  // children being created by a thread, the others value the node as a leaf meanwhile
+    Expanded,
+    Terminal,   // checkmate or draw
+};
+
+// Node of the tree, for the move leading to it. The children of a node are contiguous in the arena, and are
+// published by the release store of the Expanded state, the thread creating them being the only writer
+struct MCTSNode {
+    engine::Move move;
+    float prior;
+    unsigned int firstChild;
+    unsigned int childCount;
+    signed char terminalValue; // for the side to move, once the node is terminal
+    std::atomic<unsigned char> state;
+    std::atomic<unsigned int> visits;
+    std::atomic<unsigned int> virtualLoss;  // threads on their way down through the node, counted as lost playouts until they come back
+    std::atomic<long long> valueSum;        // for the side which played the move, in VALUE_UNIT
+
+    MCTSNode(engine::Move move, float prior)
+        : move(move), prior(prior), firstChild(0), childCount(0), terminalValue(0),
+          state(NodeState::Unexpanded), visits(0), virtualLoss(0), valueSum(0) {}
+};
+
+// Nodes per thread and playout, summed once the threads are done
+struct PlayoutCounters {
+    unsigned long long moveCount;
+    unsigned long long depthSum;
+    unsigned long long playouts;
+};
+
+// Nodes are taken from a bump allocator in one half of the arena. Reusing the tree of the previous search copies
+// the subtree of the new root into the other half, which drops the rest of the old tree at once.
+static MCTSNode *arena = nullptr;
+static unsigned int arenaCapacity = 0; // nodes in each half
+static unsigned int activeHalf = 0;
+static std::atomic<unsigned int> arenaUsed(0); // nodes taken in the active half
+static std::atomic<bool> arenaFull(false);
+
+// tree of the previous search
+static bool hasTree = false;
+static unsigned int treeRoot = NO_NODE;
+static engine::Key treeRootHash = 0;
+
+static std::atomic<unsigned long long> searchedNodes(0); // all threads, for the progress of the search
+static std::atomic<unsigned long long> searchedPlayouts(0); // all threads, against maxPlayouts
+static unsigned long long maxPlayouts = 0; // from the depth limit (0 = no limit)
+
+static bool initArena() {
+    size_t capacity = std::min(engine::getTableBudget(MCTS_TABLE_NAME) / (2 * sizeof(MCTSNode)), (size_t)(UINT_MAX / 2));
+
+    if (::arena != nullptr && capacity == ::arenaCapacity) {
+        return true;
+    }
+
+    engine::clearMonteCarloTree();
+
+    if (capacity == 0) {
+        std::cerr << "[ERROR] No memory budget for the Monte Carlo tree" << std::endl;
+
+        return false;
+    }
+
+    ::arena = static_cast<MCTSNode *>(engine::allocateTable(MCTS_TABLE_NAME, 2 * capacity * sizeof(MCTSNode)));
+
+    if (::arena == nullptr) {
+        std::cerr << "[ERROR] Could not allocate Monte Carlo tree" << std::endl;
+
+        return false;
+    }
+
+    ::arenaCapacity = capacity;
+
+    return true;
+}
+
+static unsigned int allocateNodes(unsigned int count) {
+    unsigned int used = ::arenaUsed.load(std::memory_order_relaxed);
+
+    do {
+        if (used + count > ::arenaCapacity) {
+            ::arenaFull = true;
+
+            return NO_NODE;
+        }
+    } while (!::arenaUsed.compare_exchange_weak(used, used + count, std::memory_order_relaxed));
+
+    return ::activeHalf * ::arenaCapacity + used;
+}
+
+static unsigned int newTree() {
+    ::arenaUsed = 0;
+    ::arenaFull = false;
+    ::hasTree = false;
+
+    unsigned int root = ::allocateNodes(1);
+
+    new (&::arena[root]) MCTSNode(engine::Move(), 1.0f);
+
+    return root;
+}
+
+static unsigned int findChild(unsigned int index, engine::Move &move) {
+    MCTSNode &node = ::arena[index];
+
+    if (node.state.load(std::memory_order_relaxed) != NodeState::Expanded) {
+        return NO_NODE;
+    }
+
+    for (unsigned int child = node.firstChild; child < node.firstChild + node.childCount; child++) {
+        if (::arena[child].move == move) {
+            return child;
+        }
+    }
+
+    return NO_NODE;
+}
+
+// Node of the previous tree for the position, found by following the moves played since the root of the previous search
+static unsigned int findReusableRoot(engine::Game &game) {
+    if (!::hasTree) {
+        return NO_NODE;
+    }
+
+    std::vector<engine::HistoryEntry> &history = game.getHistory();
+
+    for (size_t i = history.size(); i > 0 && history.size() - i <= engine::MCTS_REUSE_PLIES; i--) {
+        if (history[i - 1].hash != ::treeRootHash) {
+            continue;
+        }
+
+        unsigned int index = ::treeRoot;
+
+        for (size_t j = i; j < history.size() && index != NO_NODE; j++) {
+            index = ::findChild(index, history[j].move);
+        }
+
+        return index;
+    }
+
+    return NO_NODE;
+}
+
+static void copyNode(MCTSNode &source, MCTSNode *destination) {
+    unsigned char state = source.state.load(std::memory_order_relaxed);
+
+    new (destination) MCTSNode(source.move, source.prior);
+
+    destination->childCount = source.childCount;
+    destination->terminalValue = source.terminalValue;
+    destination->state.store((state == NodeState::Expanding) ? (unsigned char)NodeState::Unexpanded : state, std::memory_order_relaxed);
+    destination->visits.store(source.visits.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    destination->valueSum.store(source.valueSum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+// Copy the subtree of the node into the other half of the arena, breadth first so the children of each node stay
+// contiguous, and make it the active half. The subtree comes from one half, so it always fits in the other.
+static unsigned int moveSubtree(unsigned int index) {
+    unsigned int half = 1 - ::activeHalf;
+    unsigned int root = half * ::arenaCapacity;
+    unsigned int used = 1;
+    std::vector<std::pair<unsigned int, unsigned int>> queue = {{index, root}}; // (source, copy)
+
+    ::copyNode(::arena[index], &::arena[root]);
+
+    for (size_t i = 0; i < queue.size(); i++) {
+        MCTSNode &source = ::arena[queue[i].first];
+        MCTSNode &copy = ::arena[queue[i].second];
+
+        if (copy.state.load(std::memory_order_relaxed) != NodeState::Expanded) {
+            continue;
+        }
+
+        copy.firstChild = root + used;
+
+        for (unsigned int child = 0; child < source.childCount; child++) {
+            ::copyNode(::arena[source.firstChild + child], &::arena[copy.firstChild + child]);
+            queue.push_back({source.firstChild + child, copy.firstChild + child});
+        }
+
+        used += source.childCount;
+    }
+
+    ::activeHalf = half;
+    ::arenaUsed = used;
+    ::arenaFull = false;
+
+    return root;
+}
+
+// Create the children of the node, with priors from a softmax of their static exchange evaluation. The node becomes
+// terminal if the game is over, and stays a leaf if the arena is full
+static void expandNode(MCTSNode &node, engine::Game &game) {
+    std::vector<engine::Move> legalMoves;
+
+    engine::generateAllLegalMoves(game, legalMoves);
+
+    engine::Result result = game.result(legalMoves);
+
+    if (result != engine::Result::Undecided) {
+        node.terminalValue = (result == engine::Result::CheckMate) ? -1 : 0;
+        node.state.store(NodeState::Terminal, std::memory_order_release);
+
+        return;
+    }
+
+    unsigned int first = ::allocateNodes(legalMoves.size());
+
+    if (first == NO_NODE) {
+        node.state.store(NodeState::Unexpanded, std::memory_order_release);
+
+        return;
+    }
+
+    std::vector<double> logits(legalMoves.size(), 0.0);
+    double maxLogit = 0.0, sum = 0.0;
+
+    for (size_t i = 0; i < legalMoves.size(); i++) {
+        if (legalMoves[i].isCapture() || legalMoves[i].isPromotion()) {
+            logits[i] = engine::staticExchangeEvaluation(game, legalMoves[i]) / engine::MCTS_PRIOR_TEMPERATURE;
+            maxLogit = std::max(maxLogit, logits[i]);
+        }
+    }
+
+    for (double &logit : logits) {
+        logit = std::exp(logit - maxLogit);
+        sum += logit;
+    }
+
+    for (size_t i = 0; i < legalMoves.size(); i++) {
+        new (&::arena[first + i]) MCTSNode(legalMoves[i], logits[i] / sum);
+    }
+
+    node.firstChild = first;
+    node.childCount = legalMoves.size();
+    node.state.store(NodeState::Expanded, std::memory_order_release);
+}
+
+static double meanValue(MCTSNode &node) {
+    unsigned int visits = node.visits.load(std::memory_order_relaxed);
+
+    return (visits > 0) ? (double)node.valueSum.load(std::memory_order_relaxed) / VALUE_UNIT / visits : 0.0;
+}
+
+static int valueToScore(double value) {
+    return engine::MCTS_VALUE_SCALE * std::atanh(std::max(std::min(value, MAX_VALUE), -MAX_VALUE));
+}
+
+// Most visited move of the root, the best valued one among equals
+static unsigned int bestChild(MCTSNode &node) {
+    unsigned int best = node.firstChild;
+
+    for (unsigned int index = node.firstChild; index < node.firstChild + node.childCount; index++) {
+        unsigned int visits = ::arena[index].visits.load(std::memory_order_relaxed), bestVisits = ::arena[best].visits.load(std::memory_order_relaxed);
+
+        if (visits > bestVisits || (visits == bestVisits && ::meanValue(::arena[index]) > ::meanValue(::arena[best]))) {
+            best = index;
+        }
+    }
+
+    return best;
+}
+
+static unsigned int selectChild(MCTSNode &node) {
+    unsigned int parentVisits = node.visits.load(std::memory_order_relaxed) + node.virtualLoss.load(std::memory_order_relaxed);
+    double explorationFactor = engine::MCTS_CPUCT * std::sqrt((double)std::max(parentVisits, 1U));
+    double firstPlayUrgency = -::meanValue(node) - engine::MCTS_FPU_REDUCTION; // the node value is for the other side
+    double bestScore = -1e9;
+    unsigned int best = node.firstChild;
+
+    for (unsigned int index = node.firstChild; index < node.firstChild + node.childCount; index++) {
+        MCTSNode &child = ::arena[index];
+        unsigned int visits = child.visits.load(std::memory_order_relaxed);
+        unsigned int virtualLoss = child.virtualLoss.load(std::memory_order_relaxed);
+        double q = firstPlayUrgency;
+
+        if (visits + virtualLoss > 0) {
+            q = ((double)child.valueSum.load(std::memory_order_relaxed) / VALUE_UNIT - virtualLoss) / (visits + virtualLoss);
+        }
+
+        double score = q + explorationFactor * child.prior / (1 + visits + virtualLoss);
+
+        if (score > bestScore) {
+            bestScore = score;
+            best = index;
+        }
+    }
+
+    return best;
+}
+
+// Select down to a leaf, expand it, value it by quiescence search and back the value up the path.
+// Nothing is backed up once the search is stopped, quiescence search values are meaningless then
+static void playout(engine::Game &game, unsigned int root, std::vector<unsigned int> &path, std::vector<engine::MoveSaveState> &savedStates, PlayoutCounters &counters) {
+    unsigned int index = root;
+
+    path.clear();
+    savedStates.clear();
+    path.push_back(index);
+
+    while (::arena[index].state.load(std::memory_order_acquire) == NodeState::Expanded) {
+        index = ::selectChild(::arena[index]);
+        ::arena[index].virtualLoss.fetch_add(1, std::memory_order_relaxed);
+        path.push_back(index);
+        savedStates.push_back(game.doMove(::arena[index].move));
+        counters.moveCount++;
+    }
+
+    MCTSNode &leaf = ::arena[index];
+    unsigned char state = leaf.state.load(std::memory_order_acquire);
+
+    if (state == NodeState::Unexpanded && !::arenaFull.load(std::memory_order_relaxed) &&
+        leaf.state.compare_exchange_strong(state, NodeState::Expanding, std::memory_order_acq_rel)) {
+        ::expandNode(leaf, game);
+    }
+
+    double value; // for the side to move in the leaf position
+
+    if (leaf.state.load(std::memory_order_acquire) == NodeState::Terminal) {
+        value = leaf.terminalValue;
+    } else {
+        value = std::tanh(engine::quiesceSearch(game, engine::MIN_SCORE, engine::MAX_SCORE, counters.moveCount) / engine::MCTS_VALUE_SCALE);
+    }
+
+    bool stopped = engine::searchLimitReached(counters.moveCount);
+
+    for (size_t i = savedStates.size(); i > 0; i--) {
+        game.undoMove(::arena[path[i]].move, savedStates[i - 1]);
+    }
+
+    for (size_t i = path.size(); i > 0; i--) {
+        MCTSNode &node = ::arena[path[i - 1]];
+
+        value = -value; // the node value is for the side which played its move
+
+        if (!stopped) {
+            node.valueSum.fetch_add(std::llround(value * VALUE_UNIT), std::memory_order_relaxed);
+            node.visits.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (i > 1) {
+            node.virtualLoss.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    counters.depthSum += path.size() - 1;
+    counters.playouts++;
+}
+
+static void playouts(engine::Game &game, unsigned int root, PlayoutCounters &counters, bool mainThread) {
+    std::vector<unsigned int> path;
+    std::vector<engine::MoveSaveState> savedStates;
+    unsigned long long publishedNodes = 0;
+
+    while (!engine::searchLimitReached(counters.moveCount)) {
+        if (::maxPlayouts > 0 && ::searchedPlayouts.fetch_add(1, std::memory_order_relaxed) >= ::maxPlayouts) {
+            break;
+        }
+
+        ::playout(game, root, path, savedStates, counters);
+
+        ::searchedNodes.fetch_add(counters.moveCount - publishedNodes, std::memory_order_relaxed);
+        publishedNodes = counters.moveCount;
+
+        if (mainThread && counters.playouts % engine::MCTS_PROGRESS_PLAYOUTS == 0) { // depth is the mean depth of the playouts
+            unsigned int best = ::bestChild(::arena[root]);
+            engine::SearchProgress progress = {(unsigned int)(counters.depthSum / counters.playouts), ::searchedNodes.load(std::memory_order_relaxed),
+                                               {::arena[best].move, ::valueToScore(::meanValue(::arena[best]))}};
+
+            engine::publishSearchProgress(progress);
+        }
+    }
+}
+
+namespace engine {
+
+// Monte Carlo tree search on every search thread, sharing one tree. The move played is the most visited root move,
+// the tree is kept for the next search
+MoveValuation monteCarloSearch(Game &game, SearchLimits &limits, unsigned long long &moveCount, unsigned int &completedDepth) {
+    std::vector<Move> legalMoves;
+
+    completedDepth = 0;
+    generateAllLegalMoves(game, legalMoves);
+
+    if (game.result(legalMoves) != engine::Result::Undecided) { // nothing to search
+        return negaMax(game, 1, 1, moveCount);
+    }
+
+    if (!::initArena()) {
+        return iterativeDeepening(game, limits, moveCount, completedDepth);
+    }
+
+    beginSearch(limits, game.getActiveColor());
+
+    unsigned int root = ::findReusableRoot(game);
+
+    if (root == NO_NODE) {
+        root = ::newTree();
+    } else if (root != ::treeRoot) {
+        root = ::moveSubtree(root);
+    }
+
+    if (::arena[root].state.load(std::memory_order_relaxed) != NodeState::Expanded) {
+        if (::arena[root].state.load(std::memory_order_relaxed) != NodeState::Unexpanded) { // reused while being expanded
+            root = ::newTree();
+        }
+
+        ::expandNode(::arena[root], game);
+
+        if (::arena[root].state.load(std::memory_order_relaxed) != NodeState::Expanded) { // arena full
+            root = ::newTree();
+            ::expandNode(::arena[root], game);
+        }
+    }
+
+    ThreadPool &threadPool = getSearchThreadPool();
+    std::vector<PlayoutCounters> helperCounters(threadPool.getSize(), {0, 0, 0});
+    PlayoutCounters counters = {moveCount, 0, 0};
+    Game rootGame = game;
+
+    ::searchedNodes = 0;
+    ::searchedPlayouts = 0;
+    ::maxPlayouts = (limits.depth > 0) ? MCTS_DEPTH_PLAYOUTS << std::min(limits.depth, MCTS_MAX_DEPTH_SHIFT) : 0;
+    threadPool.start([&rootGame, root, &helperCounters](unsigned int index) {
+        Game threadGame = rootGame;
+
+        ::playouts(threadGame, root, helperCounters[index], false);
+    });
+
+    ::playouts(game, root, counters, true);
+
+    stopSearching();
+    threadPool.wait();
+
+    for (PlayoutCounters &helper : helperCounters) {
+        counters.moveCount += helper.moveCount;
+        counters.depthSum += helper.depthSum;
+        counters.playouts += helper.playouts;
+    }
+
+    ::hasTree = true;
+    ::treeRoot = root;
+    ::treeRootHash = game.getHash();
+
+    unsigned int best = ::bestChild(::arena[root]);
+    int score = ::valueToScore(::meanValue(::arena[best]));
+
+    if (::arena[best].state.load(std::memory_order_relaxed) == NodeState::Terminal && ::arena[best].terminalValue == -1) {
+        score = MAX_SCORE - 1; // mate in one
+    }
+
+    moveCount = counters.moveCount;
+    completedDepth = (counters.playouts > 0) ? std::max(counters.depthSum / counters.playouts, 1ULL) : 0;
+
+    return {::arena[best].move, score};
+}
+
+// Free the tree and its arena, which is allocated again (within the memory budget) by the next search
+void clearMonteCarloTree() {
+    if (::arena != nullptr) {
+        freeTable(::arena);
+    }
+
+    ::arena = nullptr;
+    ::arenaCapacity = 0;
+    ::activeHalf = 0;
+    ::arenaUsed = 0;
+    ::hasTree = false;
+    ::treeRoot = NO_NODE;
+}
+
+} // namespace engine
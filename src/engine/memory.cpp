@@ -0,0 +1,213 @@
+#include "include/memory.hpp"
+#include <sys/mman.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+struct TableAllocation {
+    std::string name;
+    void *mapping;
+    size_t size;        // size requested by the table
+    size_t mappedSize;  // size of the mapping (rounded up to whole huge pages)
+    engine::PageBacking backing;
+    bool shared;
+};
+
+// function local statics : tables are allocated during static initialization (the global ttable)
+static size_t &memoryBudget() {
+    static size_t budget = DEFAULT_MEMORY_BUDGET;
+
+    return budget;
+}
+
+static std::unordered_map<std::string, unsigned int> &tableShares() {
+    static std::unordered_map<std::string, unsigned int> shares = {
+        {TTABLE_NAME, 50},
+        {MCTS_TABLE_NAME, 25}, // only allocated by Monte Carlo tree searches
+        {MATE_TABLE_NAME, 25}, // only allocated by the mate solver
+    };
+
+    return shares;
+}
+
+static std::vector<TableAllocation> &allocations() {
+    static std::vector<TableAllocation> tableAllocations;
+
+    return tableAllocations;
+}
+
+static const char *backingName(engine::PageBacking backing) {
+    switch (backing) {
+        case engine::PageBacking::HugePages:
+            return "2 MB pages";
+        case engine::PageBacking::TransparentHuge:
+            return "transparent huge pages";
+        case engine::PageBacking::SmallPages:
+        default:
+            return "4 KB pages";
+    }
+}
+
+static size_t roundUp(size_t size, size_t alignment) {
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+// Anonymous mapping aligned on a huge page boundary, so the kernel can back all of it with huge pages
+static void *mapAligned(size_t size, void *&mapping, size_t &mappedSize) {
+    mappedSize = size + HUGE_PAGE_SIZE;
+    mapping = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+
+        return nullptr;
+    }
+
+    uintptr_t start = reinterpret_cast<uintptr_t>(mapping);
+    uintptr_t alignedStart = roundUp(start, HUGE_PAGE_SIZE);
+    size_t head = alignedStart - start;
+    size_t tail = mappedSize - head - size;
+
+    // give back what is not needed around the aligned block
+    if (head > 0) {
+        munmap(mapping, head);
+    }
+    if (tail > 0) {
+        munmap(reinterpret_cast<void *>(alignedStart + size), tail);
+    }
+
+    mapping = reinterpret_cast<void *>(alignedStart);
+    mappedSize = size;
+
+    return mapping;
+}
+
+namespace engine {
+
+void setMemoryBudget(size_t budget) {
+    ::memoryBudget() = budget;
+}
+
+size_t getMemoryBudget() {
+    return ::memoryBudget();
+}
+
+void setTableShare(const std::string &name, unsigned int percent) {
+    ::tableShares()[name] = percent > 100 ? 100 : percent;
+}
+
+// Part of the budget a table may use
+size_t getTableBudget(const std::string &name) {
+    auto share = ::tableShares().find(name);
+
+    if (share == ::tableShares().end()) {
+        return 0;
+    }
+
+    return ::memoryBudget() * share->second / 100;
+}
+
+// Allocate zero filled memory for a large table, backed by huge pages whenever possible.
+// The table must stay within its share of the budget (beside what other tables already use).
+// If fd is a valid file descriptor (shared memory object), the table is mapped shared from it instead.
+void *allocateTable(const std::string &name, size_t size, int fd) {
+    size_t used = getMemoryUsage();
+
+    if (size > getTableBudget(name) || used + size > ::memoryBudget()) {
+        std::cerr << "[ERROR] Table '" << name << "' (" << size << " bytes) does not fit in the memory budget ("
+                  << used << "/" << ::memoryBudget() << " bytes used, " << getTableBudget(name) << " for this table)" << std::endl;
+
+        return nullptr;
+    }
+
+    TableAllocation allocation = {name, nullptr, size, size, PageBacking::SmallPages, fd != -1};
+
+    if (fd != -1) {
+        allocation.mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+        if (allocation.mapping == MAP_FAILED) {
+            std::cerr << "[ERROR] Could not map table '" << name << "' : " << strerror(errno) << std::endl;
+
+            return nullptr;
+        }
+#ifdef MADV_HUGEPAGE
+        if (madvise(allocation.mapping, size, MADV_HUGEPAGE) == 0) { // only honoured if shmem_enabled allows it
+            allocation.backing = PageBacking::TransparentHuge;
+        }
+#endif
+    } else {
+#ifdef MAP_HUGETLB
+        if (size >= HUGE_PAGE_SIZE) { // needs pages reserved through vm.nr_hugepages
+            allocation.mappedSize = roundUp(size, HUGE_PAGE_SIZE);
+            allocation.mapping = mmap(nullptr, allocation.mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+            if (allocation.mapping != MAP_FAILED) {
+                allocation.backing = PageBacking::HugePages;
+            } else {
+                allocation.mapping = nullptr;
+            }
+        }
+#endif
+        if (allocation.mapping == nullptr && size >= HUGE_PAGE_SIZE) {
+            if (mapAligned(roundUp(size, HUGE_PAGE_SIZE), allocation.mapping, allocation.mappedSize) != nullptr) {
+#ifdef MADV_HUGEPAGE
+                if (madvise(allocation.mapping, allocation.mappedSize, MADV_HUGEPAGE) == 0) {
+                    allocation.backing = PageBacking::TransparentHuge;
+                }
+#endif
+            }
+        }
+
+        if (allocation.mapping == nullptr) {
+            allocation.mappedSize = size;
+            allocation.mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+            if (allocation.mapping == MAP_FAILED) {
+                std::cerr << "[ERROR] Could not allocate table '" << name << "' : " << strerror(errno) << std::endl;
+
+                return nullptr;
+            }
+        }
+    }
+
+    ::allocations().push_back(allocation);
+
+    return allocation.mapping;
+}
+
+void freeTable(void *memory) {
+    std::vector<TableAllocation> &tableAllocations = ::allocations();
+
+    for (auto it = tableAllocations.begin(); it != tableAllocations.end(); it++) {
+        if (it->mapping == memory) {
+            munmap(it->mapping, it->mappedSize);
+            tableAllocations.erase(it);
+
+            return;
+        }
+    }
+}
+
+size_t getMemoryUsage() {
+    size_t used = 0;
+
+    for (const TableAllocation &allocation : ::allocations()) {
+        used += allocation.size;
+    }
+
+    return used;
+}
+
+void reportMemoryUsage(std::ostream &out) {
+    for (const TableAllocation &allocation : ::allocations()) {
+        out << "\t" << allocation.name << " : " << (allocation.size >> 10) << " KB"
+            << " (" << (allocation.shared ? "shared, " : "") << ::backingName(allocation.backing) << ")\n";
+    }
+
+    out << "\ttotal : " << (getMemoryUsage() >> 10) << " KB / " << (::memoryBudget() >> 10) << " KB\n";
+}
+
+} // namespace engine
@@ -92,4 +92,15 @@ PieceType Move::getPromotedPiece() {
     return promotedPieceType;
 }
 
+// same move if same squares and same promotion, other flags depend on the position
+bool Move::operator==(const Move &move) const {
+    return this->originSquare == move.originSquare &&
+           this->targetSquare == move.targetSquare &&
+           (this->flags & (M_PROMOTION | M_PQUEEN)) == (move.flags & (M_PROMOTION | M_PQUEEN));
+}
+
+bool Move::operator!=(const Move &move) const {
+    return !(*this == move);
+}
+
 } // namespace engine
\ No newline at end of file
@@ -3,42 +3,282 @@
 #include "include/piece.hpp"
 #include "include/movesordering.hpp"
 #include <algorithm>
+#include <cstdlib>
+
+static thread_local engine::HistoryTables historyTables;
+
+// Piece types from the least to the most valuable, and their rank in this order (indexed by PieceType)
+static const engine::PieceType attackersOrder[6] = {
+    engine::PieceType::Pawn, engine::PieceType::Knight, engine::PieceType::Bishop,
+    engine::PieceType::Rook, engine::PieceType::Queen, engine::PieceType::King,
+};
+static const int captureRank[7] = {0, 1, 3, 2, 4, 5, 6};
+
+// keep values bounded : the closer to HISTORY_MAX, the smaller the effect of a bonus
+static void applyHistoryBonus(int &value, int bonus) {
+    value += bonus - value * std::abs(bonus) / HISTORY_MAX;
+}
+
+static unsigned int pieceIndex(const engine::Piece &piece) {
+    return piece.color * 6 + piece.pieceType - engine::PieceType::Pawn;
+}
+
+// The entry of the move played the given number of plies before the current position,
+// null if there is none (start of the history, null move)
+static engine::HistoryEntry *previousMove(engine::Game &game, unsigned int plies) {
+    std::vector<engine::HistoryEntry> &history = game.getHistory();
+
+    if (history.size() <= plies || history[history.size() - plies].movedPiece.pieceType == engine::PieceType::None) {
+        return nullptr;
+    }
+
+    return &history[history.size() - plies];
+}
+
+// Continuation history values of a quiet move (about to be played), one per previous move, null if there is none
+static void continuationEntries(engine::Game &game, engine::Move &move, int *entries[CONTINUATION_PLIES]) {
+    unsigned int piece = pieceIndex(game.getPiece(move.getOriginSquare()));
+
+    for (unsigned int plies = 1; plies <= CONTINUATION_PLIES; plies++) {
+        engine::HistoryEntry *previous = previousMove(game, plies);
+
+        entries[plies - 1] = nullptr;
+
+        if (previous != nullptr) {
+            unsigned int index = ((pieceIndex(previous->movedPiece) * 64 + previous->move.getTargetSquare()) * PIECE_KINDS + piece) * 64 + move.getTargetSquare();
+
+            entries[plies - 1] = &::historyTables.continuation[plies - 1][index];
+        }
+    }
+}
 
 namespace engine {
 
+HistoryTables::HistoryTables() {
+    for (unsigned int plies = 0; plies < CONTINUATION_PLIES; plies++) {
+        this->continuation[plies].assign(PIECE_KINDS * 64 * PIECE_KINDS * 64, 0);
+    }
+}
 
-int guessScore(Game &game, Move &move) {
-    int guessedScore = 0;
+// Between two searches : killers are tied to plies of the previous search, history is only decayed
+void ageHistoryTables() {
+    for (unsigned int ply = 0; ply < MAX_PLY; ply++) {
+        for (unsigned int slot = 0; slot < KILLER_SLOTS; slot++) {
+            ::historyTables.killers[ply][slot] = Move();
+        }
+    }
+
+    int *butterfly = &::historyTables.butterfly[0][0][0];
+
+    for (unsigned int i = 0; i < 2 * 64 * 64; i++) {
+        butterfly[i] /= 2;
+    }
+
+    for (unsigned int plies = 0; plies < CONTINUATION_PLIES; plies++) {
+        for (int &value : ::historyTables.continuation[plies]) {
+            value /= 2;
+        }
+    }
+}
 
-    PieceType movedPiece = game.getPiece(move.getOriginSquare()).pieceType;
-    PieceType capturedPiece = move.getCapturedPiece().pieceType;
+// A quiet move caused a beta cutoff : it becomes a killer of its ply and the counter move of the previous move,
+// gets a bonus, and the quiet moves searched before it without success get a malus, both growing with depth
+void updateHistoryTables(Game &game, Move &bestMove, std::vector<Move> &quietMoves, unsigned int ply, unsigned int depth) {
+    Color color = game.getActiveColor();
+    int bonus = std::min((int)(depth * depth), HISTORY_MAX_BONUS);
+    HistoryEntry *previous = ::previousMove(game, 1);
+    int *continuation[CONTINUATION_PLIES];
 
-    if (move.isCapture()) { // capturing a piece of better value could be a good move
-        guessedScore += 10 * pieceTypeValue[capturedPiece].first - pieceTypeValue[movedPiece].first;
+    if (ply < MAX_PLY && ::historyTables.killers[ply][0] != bestMove) {
+        ::historyTables.killers[ply][1] = ::historyTables.killers[ply][0];
+        ::historyTables.killers[ply][0] = bestMove;
     }
 
-    if (move.isPromotion()) { // promoting could be a good move
-        guessedScore += pieceTypeValue[move.getPromotedPiece()].first;
+    if (previous != nullptr) {
+        ::historyTables.counterMoves[::pieceIndex(previous->movedPiece)][previous->move.getTargetSquare()] = bestMove;
+    }
+
+    applyHistoryBonus(::historyTables.butterfly[color][bestMove.getOriginSquare()][bestMove.getTargetSquare()], bonus);
+    ::continuationEntries(game, bestMove, continuation);
+
+    for (unsigned int plies = 0; plies < CONTINUATION_PLIES; plies++) {
+        if (continuation[plies] != nullptr) {
+            applyHistoryBonus(*continuation[plies], bonus);
+        }
     }
 
-    if (game.isAttackedBy(move.getTargetSquare(), getOppositeColor(game.getActiveColor()))) { // getting threatened should be avoided
-        guessedScore -= 2 * pieceTypeValue[movedPiece].first;
+    for (Move &move : quietMoves) {
+        applyHistoryBonus(::historyTables.butterfly[color][move.getOriginSquare()][move.getTargetSquare()], -bonus);
+        ::continuationEntries(game, move, continuation);
+
+        for (unsigned int plies = 0; plies < CONTINUATION_PLIES; plies++) {
+            if (continuation[plies] != nullptr) {
+                applyHistoryBonus(*continuation[plies], -bonus);
+            }
+        }
     }
+}
+
+// How good a quiet move has been so far : from its squares (butterfly), and as a follow up of the last two moves
+int quietHistoryScore(Game &game, Move &move) {
+    int score = ::historyTables.butterfly[game.getActiveColor()][move.getOriginSquare()][move.getTargetSquare()];
+    int *continuation[CONTINUATION_PLIES];
 
-    if (game.isAttackedBy(game.getKingSquare(getOppositeColor(game.getActiveColor())), game.getActiveColor())) { // checking the king should be a good move
-        guessedScore += pieceTypeValue[movedPiece].first;
+    ::continuationEntries(game, move, continuation);
+
+    for (unsigned int plies = 0; plies < CONTINUATION_PLIES; plies++) {
+        if (continuation[plies] != nullptr) {
+            score += *continuation[plies];
+        }
     }
 
-    return guessedScore;
+    return score;
+}
+
+
+// Value of a piece during an exchange
+static int exchangeValue(PieceType pieceType) {
+    return (pieceType == PieceType::King) ? SEE_KING_VALUE : (int)pieceTypeValue[pieceType].first;
 }
 
-void orderMoves(Game &game, std::vector<Move> &moves, std::vector<unsigned int> &orderedIndices) {
-    std::vector<Move> orderedMoves;
+// Square of the least valuable piece of the given color attacking the square, 64 if none.
+// Removed squares (pieces already traded) count as empty, so sliders behind them are seen through.
+static unsigned int leastValuableAttacker(Game &game, unsigned int squareId, Color color, unsigned long long removed) {
+    int pawnSide = (color == Color::Black) ? 1 : -1;
+
+    for (PieceType attackerType : ::attackersOrder) {
+        const auto &allowedOffsets = pieceTypeOffsets[attackerType];
+
+        for (int offset : allowedOffsets.first) {
+            int currentOffset = (attackerType == PieceType::Pawn) ? offset * pawnSide : offset;
+
+            for (unsigned int testedSquare = squareId;;) {
+                testedSquare = mailbox10x12[mailbox8x8[testedSquare] + currentOffset];
+
+                if (testedSquare == XX) {
+                    break;
+                }
+
+                Piece &currentTestedPiece = game.getPiece(testedSquare);
+                bool empty = currentTestedPiece.pieceType == PieceType::None || (removed & (1ULL << testedSquare));
+
+                if (empty && allowedOffsets.second) {
+                    continue;
+                }
+
+                if (!empty && currentTestedPiece.pieceType == attackerType && currentTestedPiece.color == color) {
+                    return testedSquare;
+                }
+
+                break;
+            }
+        }
+    }
+
+    return 64;
+}
+
+// Material won by the side to move once every capture on the target square of the move has been played,
+// each side taking with its least valuable piece and free to stop when going on would lose more (pins are ignored)
+int staticExchangeEvaluation(Game &game, Move &move) {
+    unsigned int target = move.getTargetSquare();
+    Piece &movedPiece = game.getPiece(move.getOriginSquare());
+    unsigned long long removed = 1ULL << move.getOriginSquare();
+    int gain[32];
+    unsigned int d = 0;
+
+    gain[0] = 0;
+
+    if (move.isCapture()) {
+        if (game.getPiece(target).pieceType == PieceType::None) { // en passant, the captured pawn is behind the target
+            removed |= 1ULL << ((movedPiece.color == Color::White) ? target - 8 : target + 8);
+        }
+
+        gain[0] = exchangeValue(move.getCapturedPiece().pieceType);
+    }
+
+    int attackerValue = exchangeValue(movedPiece.pieceType);
+
+    if (move.isPromotion()) {
+        gain[0] += exchangeValue(move.getPromotedPiece()) - exchangeValue(PieceType::Pawn);
+        attackerValue = exchangeValue(move.getPromotedPiece());
+    }
+
+    Color side = getOppositeColor(movedPiece.color);
+
+    while (d < 31) {
+        unsigned int attacker = leastValuableAttacker(game, target, side, removed);
+
+        if (attacker == 64) {
+            break;
+        }
+
+        d++;
+        gain[d] = attackerValue - gain[d - 1]; // score if the piece on the target square is taken
+        attackerValue = exchangeValue(game.getPiece(attacker).pieceType);
+        removed |= 1ULL << attacker;
+        side = getOppositeColor(side);
+    }
+
+    while (d > 0) { // each side may stand pat instead of capturing
+        gain[d - 1] = -std::max(-gain[d - 1], gain[d]);
+        d--;
+    }
+
+    return gain[0];
+}
+
+// Winning and equal captures (and promotions) by MVV-LVA with the exchange value breaking ties, losing ones by
+// exchange value. A quiet move only gets the material it is expected to lose on its target square.
+int guessScore(Game &game, Move &move) {
+    int exchange = staticExchangeEvaluation(game, move);
+
+    if (!move.isCapture() && !move.isPromotion()) {
+        return exchange;
+    }
+
+    if (exchange < 0) {
+        return LOSING_CAPTURE_SCORE + exchange;
+    }
+
+    int victimRank = move.isCapture() ? ::captureRank[move.getCapturedPiece().pieceType] : 0;
+
+    if (move.isPromotion()) {
+        victimRank += ::captureRank[move.getPromotedPiece()];
+    }
+
+    int mvvLva = 8 * victimRank - ::captureRank[game.getPiece(move.getOriginSquare()).pieceType];
+
+    return CAPTURE_SCORE + mvvLva * MVV_LVA_WEIGHT + std::min(exchange, MVV_LVA_WEIGHT - 1);
+}
+
+// The hash move (best move stored in the transposition table) is only searched first
+// if it is found among the legal moves, a move from a colliding entry is ignored.
+// Then come winning captures and promotions, killer moves of this ply, the counter move of the previous move,
+// quiet moves by history, and losing captures.
+void orderMoves(Game &game, std::vector<Move> &moves, std::vector<unsigned int> &orderedIndices, Move hashMove, unsigned int ply) {
     std::vector<int> guessedScores;
+    HistoryEntry *previous = ::previousMove(game, 1);
+    Move counterMove = (previous != nullptr) ? ::historyTables.counterMoves[::pieceIndex(previous->movedPiece)][previous->move.getTargetSquare()] : Move();
 
     for (unsigned int i = 0; i < moves.size(); i++) {
+        Move &move = moves[i];
+
         orderedIndices.push_back(i);
-        guessedScores.push_back(guessScore(game, moves[i]));
+
+        if (move == hashMove) {
+            guessedScores.push_back(HASH_MOVE_SCORE);
+        } else if (move.isCapture() || move.isPromotion()) {
+            guessedScores.push_back(guessScore(game, move));
+        } else if (ply < MAX_PLY && move == ::historyTables.killers[ply][0]) {
+            guessedScores.push_back(KILLER_MOVE_SCORE);
+        } else if (ply < MAX_PLY && move == ::historyTables.killers[ply][1]) {
+            guessedScores.push_back(KILLER_MOVE_SCORE - 1);
+        } else if (move == counterMove) {
+            guessedScores.push_back(COUNTER_MOVE_SCORE);
+        } else {
+            guessedScores.push_back(guessScore(game, move) + quietHistoryScore(game, move));
+        }
     }
 
     std::sort(orderedIndices.begin(), orderedIndices.end(), [&](unsigned int &i, unsigned int &j) {
@@ -4,17 +4,365 @@
 #include "include/movesgeneration.hpp"
 #include "include/movesordering.hpp"
 #include "include/transpositiontable.hpp"
+#include "include/timemanagement.hpp"
+#include "include/threadpool.hpp"
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 static engine::TTable ttable;
+static engine::TimeManager timeManager;
+static engine::SearchLimits searchLimits;
+static std::atomic<bool> stopSearch(false);
+static thread_local std::atomic<bool> *stopRequest = nullptr; // stop latched by the search handle running on this thread
+static thread_local unsigned int nullMoveMinPly = 0; // no null move before this ply (set during null move verification searches)
+static thread_local unsigned int rootDepth = engine::MAX_DEPTH; // depth of the current iteration, to bound extensions
+static thread_local std::vector<engine::Move> pvLines[engine::PV_MAX_PLY + 1]; // [ply] : best line found from the node at this ply
+static engine::ThreadPool threadPool; // lazy SMP or young brothers wait helpers, the main search thread is not part of it
+static engine::SearchMethod searchMethod = engine::SearchMethod::PrincipalVariation;
+static engine::Color searchColor = engine::Color::White; // side to move at the root, for the time manager
+
+// limits given by a ponder hit, applied by the main search thread on its next poll
+static std::atomic<bool> ponderHitPending(false);
+static std::mutex ponderMutex;
+static engine::SearchLimits ponderHitLimits;
+
+// progress of the running search, published by the thread running iterative deepening
+static thread_local bool mainSearchThread = false;
+static std::mutex progressMutex;
+static engine::SearchProgress searchProgress;
+static std::vector<engine::Move> searchPV; // of the last completed iteration, from the position with searchPVHash
+static engine::Key searchPVHash = 0;
+static std::atomic<unsigned long long> searchedNodes(0);
+
+// What the moves of a node share once the pruning of the node itself is done : the thread searching the node
+// and the threads joining its split point search every move the same way (see searchNodeMove())
+struct SearchNode {
+    unsigned int maxDepth;
+    unsigned int depth;
+    bool pvNode;
+    bool cutNode;
+    bool inCheck;
+    bool futile;          // quiet moves not giving check are pruned
+    bool lateMovePruning; // late quiet moves are pruned
+    bool singular;        // the hash move is extended
+    bool orderingMoves;
+    engine::Move hashMove;
+};
+
+// Node of the tree whose younger brothers are searched in parallel (young brothers wait concept) : any idle
+// thread may join, copy the position, and take the next move to search. The window is shared, and a beta
+// cutoff cancels the whole split point (and every split point below it).
+struct SplitPoint {
+    SplitPoint *parent;
+    engine::Game game;              // position of the node, copied by joining threads
+    SearchNode node;
+    std::vector<engine::Move> moves; // moves left once the eldest brother has been searched
+    unsigned int rootDepth;
+    unsigned int nullMoveMinPly;
+    int beta;
+
+    std::atomic<unsigned int> nextMove;
+    std::atomic<int> alpha;
+    std::atomic<bool> cancelled;
+    std::atomic<unsigned int> quietMovesNumber; // for late move pruning, quiet moves searched or pruned by futility
+    std::atomic<unsigned int> workers;  // helper threads inside, the owner waits for them before leaving
+    std::atomic<unsigned long long> moveCount; // nodes searched by the helpers
+
+    std::mutex mutex; // best move, score, line and quiet moves
+    engine::MoveValuation bestMoveValuation;
+    std::vector<engine::Move> pv;
+    std::vector<engine::Move> quietMoves; // quiet moves searched without cutoff, for the history tables
+    std::condition_variable workersDone; // with the mutex, the last helper leaving wakes the owner
+
+    SplitPoint(SplitPoint *parent, engine::Game &game, SearchNode &node, int alpha, int beta, unsigned int quietMovesNumber,
+               engine::MoveValuation best, std::vector<engine::Move> &pv)
+        : parent(parent), game(game), node(node), rootDepth(::rootDepth), nullMoveMinPly(::nullMoveMinPly), beta(beta),
+          nextMove(0), alpha(alpha), cancelled(false), quietMovesNumber(quietMovesNumber), workers(0), moveCount(0),
+          bestMoveValuation(best), pv(pv) {}
+};
+
+static thread_local SplitPoint *currentSplitPoint = nullptr; // innermost split point this thread is working for
+static std::mutex splitPointsMutex;
+static std::vector<SplitPoint *> splitPoints; // split points with moves left to search
+static unsigned int lateMoveReductions[engine::MAX_DEPTH + 1][engine::LMR_MAX_MOVES]; // [depth][move number]
+
+static void initLateMoveReductions() {
+    static bool initialized = false;
+
+    if (initialized) {
+        return;
+    }
+
+    for (unsigned int depth = 1; depth <= engine::MAX_DEPTH; depth++) {
+        for (unsigned int moveNumber = 1; moveNumber < engine::LMR_MAX_MOVES; moveNumber++) {
+            ::lateMoveReductions[depth][moveNumber] = engine::LMR_BASE + std::log(depth) * std::log(moveNumber) / engine::LMR_DIVISOR;
+        }
+    }
+
+    initialized = true;
+}
+
+static void startSearch(engine::SearchLimits &limits, engine::Color color) {
+    ::searchLimits = limits;
+    ::searchColor = color;
+    ::timeManager.init(limits, color);
+    ::stopSearch = false;
+
+    // a stop requested before the search started would be lost with the flag
+    if (::stopRequest != nullptr && ::stopRequest->load()) {
+        ::stopSearch = true;
+    }
+
+    ::nullMoveMinPly = 0;
+    ::mainSearchThread = true;
+
+    engine::resetSearchProgress();
+
+    {
+        std::lock_guard<std::mutex> lock(::progressMutex);
+
+        ::searchPV.clear();
+    }
+
+    initLateMoveReductions();
+    engine::ageHistoryTables();
+}
+
+// Any piece beside king and pawns left, told by the pieces the opponent captured. Promoted pieces are
+// not counted, which only makes null move pruning more careful.
+static bool hasNonPawnMaterial(engine::Game &game, engine::Color color) {
+    std::unordered_map<engine::PieceType, unsigned char> &captured = game.getCapturedPieces(engine::getOppositeColor(color));
+
+    return captured[engine::PieceType::Bishop] < 2 || captured[engine::PieceType::Knight] < 2 ||
+           captured[engine::PieceType::Rook] < 2 || captured[engine::PieceType::Queen] < 1;
+}
+
+// Scores of a forced mate within the search horizon, which must not be pruned on evaluation margins
+static bool isMateScore(int score) {
+    return std::abs(score) >= engine::MATE_BOUND;
+}
+
+// The conversion keeps the order of scores, so the bound type computed from the converted window is unchanged
+static void storeEntry(engine::Game &game, engine::Move &move, unsigned int depth, int valuation, int alpha, int beta, unsigned int ply) {
+    ::ttable.addEntry(game.getHash(), move, depth, engine::scoreToTTable(valuation, ply), engine::scoreToTTable(alpha, ply), engine::scoreToTTable(beta, ply));
+}
+
+// Play the given line from the position, then the moves of exact transposition table entries (stored by PV nodes),
+// as long as they are legal and don't repeat a position, up to maxLength moves. The moves played are added to
+// moves, and the position is left unchanged.
+static void followLine(engine::Game &game, std::vector<engine::Move> &line, unsigned int maxLength, std::vector<engine::Move> &moves) {
+    std::vector<engine::MoveSaveState> savedStates;
+    size_t start = moves.size();
+
+    while (moves.size() - start < maxLength && (moves.size() == start || !game.hasRepeated())) {
+        engine::Move nextMove;
+
+        if (moves.size() - start < line.size()) {
+            nextMove = line[moves.size() - start];
+        } else {
+            engine::TTEntry entry = ::ttable.getEntry(game.getHash());
+
+            if (game.getHash() != entry.hash || entry.entryType != engine::TTEntryType::Exact) {
+                break;
+            }
+
+            nextMove = entry.move;
+        }
+
+        std::vector<engine::Move> legalMoves;
+
+        engine::generateAllLegalMoves(game, legalMoves);
+
+        auto found = std::find(legalMoves.begin(), legalMoves.end(), nextMove);
+
+        if (found == legalMoves.end()) { // colliding entry
+            break;
+        }
+
+        moves.push_back(*found);
+        savedStates.push_back(game.doMove(moves.back()));
+    }
+
+    for (size_t i = moves.size(); i > start; i--) {
+        game.undoMove(moves[i - 1], savedStates[i - start - 1]);
+    }
+}
+
+// Triangular principal variation : each node starts with an empty line, and a move raising alpha at a PV node
+// makes its line that move followed by the line of the child. A PV node is only cut by an exact transposition
+// table entry when the table gives its line to the full depth. Lines end where the search ended (quiescence
+// or repetition).
+static void clearPV(unsigned int ply) {
+    if (ply <= engine::PV_MAX_PLY) {
+        ::pvLines[ply].clear();
+    }
+}
+
+static bool pvFromTTable(engine::Game &game, unsigned int ply, unsigned int depth) {
+    if (ply > engine::PV_MAX_PLY) {
+        return true;
+    }
+
+    std::vector<engine::Move> noLine;
+    unsigned int length = std::min(depth, engine::PV_MAX_PLY - ply);
+
+    if (!game.hasRepeated()) {
+        ::followLine(game, noLine, length, ::pvLines[ply]);
+    }
+
+    return ::pvLines[ply].size() >= length;
+}
+
+static void updatePV(unsigned int ply, engine::Move &move, std::vector<engine::Move> &line) {
+    line.assign(1, move);
+
+    if (ply < engine::PV_MAX_PLY) {
+        line.insert(line.end(), ::pvLines[ply + 1].begin(), ::pvLines[ply + 1].end());
+    }
+}
+
+static void updatePV(unsigned int ply, engine::Move &move) {
+    if (ply <= engine::PV_MAX_PLY) {
+        ::updatePV(ply, move, ::pvLines[ply]);
+    }
+}
+
+// The search got stopped, or a split point this thread is working for got a cutoff : the result is meaningless
+static bool searchAborted() {
+    if (::stopSearch.load(std::memory_order_relaxed)) {
+        return true;
+    }
+
+    for (SplitPoint *splitPoint = ::currentSplitPoint; splitPoint != nullptr; splitPoint = splitPoint->parent) {
+        if (splitPoint->cancelled.load(std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// The opponent played the expected move : the ponder search goes on as the real search, under the real limits,
+// timed from now. Only the main search thread reads the limits and the time manager, so it applies them itself.
+static void applyPonderHit() {
+    if (!::ponderHitPending.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(::ponderMutex);
+
+    ::searchLimits = ::ponderHitLimits;
+    ::searchLimits.ponder = false;
+    ::timeManager.init(::searchLimits, ::searchColor);
+    ::ponderHitPending = false;
+}
+
+// Poll the limits every NODES_BETWEEN_POLLS nodes, once the search is stopped every node returns at once.
+// Helper threads only follow the stop flag, the main search thread enforces the limits for all of them.
+static bool searchStopped(unsigned long long moveCount) {
+    if (::searchAborted()) {
+        return true;
+    }
+
+    if (!::mainSearchThread) {
+        return false;
+    }
+
+    if ((moveCount % engine::NODES_BETWEEN_POLLS) == 0) {
+        ::applyPonderHit();
+        ::searchedNodes.store(moveCount, std::memory_order_relaxed);
+    }
+
+    if ((::searchLimits.nodes > 0 && moveCount >= ::searchLimits.nodes) ||
+        ((moveCount % engine::NODES_BETWEEN_POLLS) == 0 && ::timeManager.hardLimitReached())) {
+        ::stopSearch = true;
+    }
+
+    return ::stopSearch.load(std::memory_order_relaxed);
+}
+
+// Waiting for the helpers of a split point, the main search thread still enforces the time limit
+static void pollTimeLimit() {
+    if (!::mainSearchThread) {
+        return;
+    }
+
+    ::applyPonderHit();
+
+    if (::timeManager.hardLimitReached()) {
+        ::stopSearch = true;
+    }
+}
 
 namespace engine {
 
+TTable &getTranspositionTable() {
+    return ::ttable;
+}
+
+// Mate scores count plies from the root, but from the position itself in the transposition table,
+// so an entry stays right when the position is reached at another ply
+int scoreToTTable(int score, unsigned int ply) {
+    if (score >= engine::MATE_BOUND) {
+        return score + ply;
+    } else if (score <= -engine::MATE_BOUND) {
+        return score - ply;
+    }
+
+    return score;
+}
+
+int scoreFromTTable(int score, unsigned int ply) {
+    if (score >= engine::MATE_BOUND) {
+        return score - ply;
+    } else if (score <= -engine::MATE_BOUND) {
+        return score + ply;
+    }
+
+    return score;
+}
+
 int quiesceSearch(Game &game, int alpha, int beta, unsigned long long &moveCount, bool orderingMoves) {
+    if (::searchStopped(moveCount)) {
+        return 0;
+    }
+
+    int originalAlpha = alpha;
+    TTEntry entry = ::ttable.getEntry(game.getHash());
+    Move hashMove;
+
+    // any entry of this position is deep enough, but mate scores would need the ply to be converted
+    if (game.getHash() == entry.hash) {
+        hashMove = entry.move;
+
+        if (!::isMateScore(entry.valuation)) {
+            if (entry.entryType == TTEntryType::Exact) {
+                return std::max(alpha, std::min(beta, entry.valuation));
+            } else if (entry.entryType == TTEntryType::Lower && entry.valuation >= beta) {
+                return beta;
+            } else if (entry.entryType == TTEntryType::Upper && entry.valuation <= alpha) {
+                return alpha;
+            }
+        }
+    }
+
+    bool storable = game.getHash() != entry.hash || entry.depth <= QUIESCENCE_DEPTH; // never replace a full search entry
+    Move bestMove;
     int stand_pat = evaluate(game);
 
     if (stand_pat >= beta) {
+        if (storable) {
+            ::storeEntry(game, bestMove, QUIESCENCE_DEPTH, beta, originalAlpha, beta, 0);
+        }
+
         return beta;
     }
     if (alpha < stand_pat) {
@@ -27,175 +375,1183 @@ int quiesceSearch(Game &game, int alpha, int beta, unsigned long long &moveCount
     generateAllLegalMoves(game, legalMoves, true);
 
     if (orderingMoves) {
-        orderMoves(game, legalMoves, orderedIndices);
+        orderMoves(game, legalMoves, orderedIndices, hashMove);
     }
 
     for (unsigned int i = 0; i < legalMoves.size(); i++) {
-        Move &currentMove = legalMoves[i];
+        Move &currentMove = legalMoves[orderingMoves ? orderedIndices[i] : i];
 
-        moveCount++;
+        // delta pruning : even winning the captured piece for free wouldn't be enough
+        if (currentMove.isCapture() && !currentMove.isPromotion() &&
+            stand_pat + (int)pieceTypeValue[currentMove.getCapturedPiece().pieceType].first + DELTA_MARGIN <= alpha) {
+            continue;
+        }
 
-        if (orderingMoves) {
-            currentMove = legalMoves[orderedIndices[i]];
+        if (staticExchangeEvaluation(game, currentMove) < 0) { // losing captures can't raise the stand pat
+            continue;
         }
 
+        moveCount++;
+
         engine::MoveSaveState savedState = game.doMove(currentMove);
         int score = -quiesceSearch(game, -beta, -alpha, moveCount, orderingMoves);
         game.undoMove(currentMove, savedState);
 
+        if (::searchAborted()) {
+            return 0;
+        }
+
         if (score >= beta) {
+            if (storable) {
+                ::storeEntry(game, currentMove, QUIESCENCE_DEPTH, beta, originalAlpha, beta, 0);
+            }
+
             return beta;
         }
 
-        alpha = std::max(score, alpha);
+        if (score > alpha) {
+            alpha = score;
+            bestMove = currentMove;
+        }
+    }
+
+    if (storable) {
+        ::storeEntry(game, bestMove, QUIESCENCE_DEPTH, alpha, originalAlpha, beta, 0);
     }
 
     return alpha;
 }
 
-int alphabeta(engine::Game &game, unsigned int maxDepth, unsigned int depth, int alpha, int beta, unsigned long long &moveCount, bool orderingMoves) {
-    if (depth == 0) {
-        return quiesceSearch(game, alpha, beta, moveCount, orderingMoves);
+// Search a move of a node, the i-th in the move ordering : check and singular extensions, then principal variation
+// search with late move reductions. Returns false, without searching it, when futility pruning skips the move.
+static bool searchNodeMove(Game &game, const SearchNode &node, Move &move, unsigned int i, int alpha, int beta, unsigned long long &moveCount, int &evaluation) {
+    unsigned int maxDepth = node.maxDepth;
+    unsigned int depth = node.depth;
+    unsigned int ply = maxDepth - depth;
+    bool quiet = !move.isCapture() && !move.isPromotion();
+
+    moveCount++;
+
+    int historyScore = (quiet && i > 0) ? quietHistoryScore(game, move) : 0;
+
+    engine::MoveSaveState savedState = game.doMove(move);
+    bool givesCheck = game.isAttackedBy(game.getKingSquare(game.getActiveColor()), getOppositeColor(game.getActiveColor()));
+
+    if (node.futile && i > 0 && quiet && !givesCheck) {
+        game.undoMove(move, savedState);
+
+        return false;
     }
 
-    int originalAlpha = alpha;
+    // check and singular extensions, searching the move one ply deeper (the ply of the child doesn't change)
+    unsigned int extension = 0;
 
-    TTEntry entry = ::ttable.getEntry(game.getHash());
+    if (ply < 2 * ::rootDepth && (givesCheck || (node.singular && move == node.hashMove))) {
+        extension = 1;
+    }
 
-    if (game.getHash() == entry.hash && entry.depth >= depth) {
-        if (entry.entryType == TTEntryType::Exact) {
-            return entry.valuation;
-        } else if (entry.entryType == TTEntryType::Lower) {
-            alpha = std::max(alpha, entry.valuation);
-        } else if (entry.entryType == TTEntryType::Upper) {
-            beta = std::min(beta, entry.valuation);
+    unsigned int childMaxDepth = maxDepth + extension;
+    unsigned int childDepth = depth - 1 + extension;
+
+    // principal variation search : only the first move gets the full window, the others only have
+    // to be proven worse (null window) and are searched again if they turn out better
+    if (i == 0) {
+        evaluation = -alphabeta(game, childMaxDepth, childDepth, -beta, -alpha, moveCount, node.orderingMoves, !node.pvNode && !node.cutNode);
+    } else {
+        unsigned int reduction = 0;
+
+        // late move reductions : quiet moves far in the ordering are unlikely to be good, they are searched
+        // at reduced depth first, and at full depth only if they beat alpha
+        if (depth >= LMR_DEPTH && i >= (node.pvNode ? LMR_PV_MOVE_NUMBER : LMR_MOVE_NUMBER) && quiet && !node.inCheck && !givesCheck) {
+            int r = ::lateMoveReductions[std::min(depth, MAX_DEPTH)][std::min(i, LMR_MAX_MOVES - 1)];
+
+            r += node.cutNode ? 1 : 0;
+            r -= node.pvNode ? 1 : 0;
+            r -= historyScore / LMR_HISTORY_DIVISOR; // less reduction for moves that did well, more for the others
+            reduction = std::min(std::max(r, 0), (int)depth - 2); // reduced search is at least depth 1
         }
 
-        if (alpha >= beta) {
-            return entry.valuation;
+        if (reduction > 0) {
+            unsigned int reducedDepth = depth - 1 - reduction;
+
+            evaluation = -alphabeta(game, ply + 1 + reducedDepth, reducedDepth, -alpha - 1, -alpha, moveCount, node.orderingMoves, true);
+        } else {
+            evaluation = alpha + 1; // not reduced, go straight to the null window search
+        }
+
+        if (evaluation > alpha) {
+            evaluation = -alphabeta(game, childMaxDepth, childDepth, -alpha - 1, -alpha, moveCount, node.orderingMoves, !node.cutNode);
+        }
+
+        if (evaluation > alpha && evaluation < beta) { // can only happen at PV nodes
+            evaluation = -alphabeta(game, childMaxDepth, childDepth, -beta, -alpha, moveCount, node.orderingMoves, false);
         }
     }
 
-    std::vector<Move> legalMoves;
+    game.undoMove(move, savedState);
 
-    generateAllLegalMoves(game, legalMoves);
+    return true;
+}
 
-    engine::Result result = game.result(legalMoves);
+// Search the moves of a split point with the thread's own copy of its position, until there are none left
+// or the split point gets cancelled. Moves are searched as in alphabeta(), against the shared alpha.
+static void searchSplitPoint(SplitPoint &splitPoint, Game &game, unsigned long long &moveCount) {
+    SplitPoint *previousSplitPoint = ::currentSplitPoint;
+    SearchNode &node = splitPoint.node;
+    unsigned int ply = node.maxDepth - node.depth;
 
-    if (result != engine::Result::Undecided) {
-        int evaluation = 0;
+    ::currentSplitPoint = &splitPoint;
 
-        switch (result) {
-            case engine::Result::CheckMate: {
-                evaluation = MIN_SCORE;
-                evaluation += maxDepth - depth;
+    for (;;) {
+        unsigned int i = splitPoint.nextMove++;
 
-                break;
-            }
-            default:
-                break;
+        if (i >= splitPoint.moves.size() || ::searchAborted()) {
+            break;
         }
 
-        return evaluation;
-    }
+        Move &currentMove = splitPoint.moves[i];
+        bool quiet = !currentMove.isCapture() && !currentMove.isPromotion();
 
-    std::vector<unsigned int> orderedIndices;
+        if (quiet && node.lateMovePruning && splitPoint.quietMovesNumber.load() >= LMP_BASE + node.depth * node.depth) {
+            continue;
+        }
 
-    if (orderingMoves) {
-        orderMoves(game, legalMoves, orderedIndices);
-    }
+        splitPoint.quietMovesNumber += quiet ? 1 : 0;
 
-    MoveValuation bestMoveValuation = {Move(), MIN_SCORE};
+        int alpha = splitPoint.alpha.load();
+        int evaluation;
 
-    for (unsigned int i  = 0; i < legalMoves.size(); i++) {
-        Move &currentMove = legalMoves[i];
+        if (!searchNodeMove(game, node, currentMove, i + 1, alpha, splitPoint.beta, moveCount, evaluation)) {
+            continue;
+        }
 
-        moveCount++;
+        if (::searchAborted()) {
+            break;
+        }
 
-        if (orderingMoves) {
-            currentMove = legalMoves[orderedIndices[i]];
+        std::lock_guard<std::mutex> lock(splitPoint.mutex);
+
+        // failing low returns alpha itself, a later move doing the same is no better than the first one
+        if (evaluation > splitPoint.bestMoveValuation.second || splitPoint.bestMoveValuation.first.getOriginSquare() >= 64) {
+            splitPoint.bestMoveValuation = {currentMove, evaluation};
         }
 
-        engine::MoveSaveState savedState = game.doMove(currentMove);
-        int evaluation = -alphabeta(game, maxDepth, depth - 1, -beta, -alpha, moveCount, orderingMoves);
-        game.undoMove(currentMove, savedState);
+        if (node.pvNode && evaluation > splitPoint.alpha.load()) {
+            ::updatePV(ply, currentMove, splitPoint.pv);
+        }
 
-        if (evaluation >= bestMoveValuation.second) {
-            bestMoveValuation.second = evaluation;
-            bestMoveValuation.first = currentMove;
+        if (evaluation > splitPoint.alpha.load()) {
+            splitPoint.alpha = evaluation;
         }
 
-        alpha = std::max(alpha, evaluation);
+        if (evaluation >= splitPoint.beta) { // the other threads can stop
+            splitPoint.cancelled = true;
+        } else if (quiet) {
+            splitPoint.quietMoves.push_back(currentMove);
+        }
+    }
 
-        if (alpha >= beta) {
-            break;
+    ::currentSplitPoint = previousSplitPoint;
+}
+
+// Split point with moves left to search, nullptr if there is none. Called with splitPointsMutex held
+static SplitPoint *findSplitPoint() {
+    for (SplitPoint *candidate : ::splitPoints) {
+        if (candidate->nextMove.load() < candidate->moves.size() && !candidate->cancelled.load()) {
+            return candidate;
         }
     }
 
-    ::ttable.addEntry(game.getHash(), bestMoveValuation.first, depth, bestMoveValuation.second, originalAlpha, beta);
+    return nullptr;
+}
+
+// Wake the helpers parked in youngBrothersWaitHelper(), after a split point was added or the search stopped
+static void wakeHelpers() {
+    {
+        std::lock_guard<std::mutex> lock(::splitPointsMutex); // a helper checking for work can't miss the notification
+    }
 
-    return bestMoveValuation.second;
+    ::threadPool.notifyWork();
 }
 
-MoveValuation negaMax(Game &game, unsigned int maxDepth, unsigned int depth, unsigned long long &moveCount, bool orderingMoves) {
-    MoveValuation bestMoveValuation = {Move(), MIN_SCORE};
-    std::vector<Move> legalMoves;
+// Helper thread of the young brothers wait search : join any split point with moves left, until the search ends.
+// Without one, the helper is parked in the thread pool until a split point is added.
+static void youngBrothersWaitHelper() {
+    ageHistoryTables();
 
-    generateAllLegalMoves(game, legalMoves);
+    for (;;) {
+        SplitPoint *splitPoint = nullptr;
 
-    engine::Result result = game.result(legalMoves);
+        {
+            std::unique_lock<std::mutex> lock(::splitPointsMutex);
 
-    if (result != engine::Result::Undecided) {
-        switch (result) {
-            case engine::Result::Draw: {
-                bestMoveValuation.second = 0;
-                bestMoveValuation.second += (game.getHash() & 0x2) - 1;
+            ::threadPool.waitForWork(lock, [&splitPoint]() {
+                splitPoint = findSplitPoint();
 
-                break;
-            }
-            case engine::Result::CheckMate: {
-                bestMoveValuation.second = MIN_SCORE;
-                bestMoveValuation.second += (maxDepth - depth); // distance to mate
-                // DTM should always be 0 here, but I'm keeping it for clarity sake
+                return splitPoint != nullptr || ::stopSearch.load(std::memory_order_relaxed);
+            });
 
-                break;
+            if (::stopSearch.load(std::memory_order_relaxed)) {
+                return;
             }
-            default:
-                break;
+
+            splitPoint->workers++; // under the lock, so the owner can't leave in between
         }
 
-        return bestMoveValuation;
+        Game game = splitPoint->game;
+        unsigned long long moveCount = 0;
+
+        ::rootDepth = splitPoint->rootDepth;
+        ::nullMoveMinPly = splitPoint->nullMoveMinPly;
+        searchSplitPoint(*splitPoint, game, moveCount);
+        ::nullMoveMinPly = 0;
+        splitPoint->moveCount += moveCount;
+
+        std::lock_guard<std::mutex> lock(splitPoint->mutex);
+
+        if (--splitPoint->workers == 0) {
+            splitPoint->workersDone.notify_one();
+        }
     }
+}
 
-    std::vector<unsigned int> orderedIndices;
+// Young brothers wait : the moves left once the eldest brother has been searched are shared between this thread
+// and the helpers joining the split point of the node. Returns false if the search got aborted, otherwise the
+// best move, the line and the quiet moves of the node are updated with those of the split point.
+static bool splitNode(Game &game, SearchNode &node, std::vector<Move> &moves, int alpha, int beta, unsigned int quietMovesNumber,
+                      MoveValuation &bestMoveValuation, std::vector<Move> &quietMoves, unsigned long long &moveCount) {
+    unsigned int ply = node.maxDepth - node.depth;
+    std::vector<Move> noLine;
+    SplitPoint splitPoint(::currentSplitPoint, game, node, alpha, beta, quietMovesNumber, bestMoveValuation,
+                          (ply <= PV_MAX_PLY) ? ::pvLines[ply] : noLine);
 
-    if (orderingMoves) {
-        orderMoves(game, legalMoves, orderedIndices);
+    splitPoint.moves = moves;
+
+    {
+        std::lock_guard<std::mutex> lock(::splitPointsMutex);
+
+        ::splitPoints.push_back(&splitPoint);
     }
 
-    for (unsigned int i = 0; i < legalMoves.size(); i++) {
-        Move &currentMove = legalMoves[i];
+    ::threadPool.notifyWork();
 
-        moveCount++;
+    searchSplitPoint(splitPoint, game, moveCount);
+
+    {
+        std::lock_guard<std::mutex> lock(::splitPointsMutex);
 
-        if (orderingMoves) {
-            currentMove = legalMoves[orderedIndices[i]];
+        ::splitPoints.erase(std::find(::splitPoints.begin(), ::splitPoints.end(), &splitPoint));
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(splitPoint.mutex); // helpers still searching moves taken before the removal
+
+        while (!splitPoint.workersDone.wait_for(lock, std::chrono::milliseconds(YBW_WAIT_POLL_TIME),
+                                                [&splitPoint]() { return splitPoint.workers.load() == 0; })) {
+            ::pollTimeLimit(); // once stopped, the helpers leave at once
         }
+    }
 
-        // std::cout << "Current move evaluated : " << utils::caseNameFromId(currentMove.getOriginSquare()) << utils::caseNameFromId(currentMove.getTargetSquare()) << " (valuation = ";
+    moveCount += splitPoint.moveCount.load();
 
-        engine::MoveSaveState savedState = game.doMove(currentMove);
-        int moveScore = -alphabeta(game, maxDepth, depth - 1, -32000, 32000, moveCount, orderingMoves);
-        game.undoMove(currentMove, savedState);
+    if (::searchAborted()) {
+        return false;
+    }
 
-        // std::cout << moveScore << "/ best = " << bestMoveValuation.second << ")" << std::endl;
+    bestMoveValuation = splitPoint.bestMoveValuation;
+    quietMoves.insert(quietMoves.end(), splitPoint.quietMoves.begin(), splitPoint.quietMoves.end());
 
-        if (moveScore >= bestMoveValuation.second) {
-            bestMoveValuation = {currentMove, moveScore};
-        }
+    if (ply <= PV_MAX_PLY) {
+        ::pvLines[ply] = splitPoint.pv;
     }
 
-    return bestMoveValuation;
+    return true;
 }
 
-}
\ No newline at end of file
+int alphabeta(engine::Game &game, unsigned int maxDepth, unsigned int depth, int alpha, int beta, unsigned long long &moveCount, bool orderingMoves, bool cutNode, Move excludedMove) {
+    unsigned int ply = maxDepth - depth;
+
+    ::clearPV(ply);
+
+    if (depth == 0) {
+        return quiesceSearch(game, alpha, beta, moveCount, orderingMoves);
+    }
+
+    if (::searchStopped(moveCount)) {
+        return 0;
+    }
+
+    bool pvNode = beta - alpha > 1;
+    bool excluding = excludedMove.getOriginSquare() < 64; // singular extension search, without the hash move
+
+    // mate distance pruning : no score can be better than mating at the next ply, or worse than being mated here
+    alpha = std::max(alpha, MIN_SCORE + (int)ply);
+    beta = std::min(beta, MAX_SCORE - (int)ply - 1);
+
+    if (alpha >= beta) {
+        return alpha;
+    }
+
+    // upcoming repetition : the side to move can repeat an earlier position, so it gets at least a draw
+    if (ply > 0 && alpha < NULL_SCORE && game.hasUpcomingRepetition()) {
+        alpha = NULL_SCORE;
+
+        if (alpha >= beta) {
+            return alpha;
+        }
+    }
+
+    int originalAlpha = alpha;
+
+    TTEntry entry = ::ttable.getEntry(game.getHash());
+    Move hashMove;
+
+    entry.valuation = scoreFromTTable(entry.valuation, ply);
+
+    if (game.getHash() == entry.hash) {
+        hashMove = entry.move; // still the best ordering guess, even from a shallower search
+    }
+
+    if (!excluding && game.getHash() == entry.hash && entry.depth >= depth) {
+        if (entry.entryType == TTEntryType::Exact) {
+            if (!pvNode || ::pvFromTTable(game, ply, depth)) { // at PV nodes, the line must be there as well
+                return entry.valuation;
+            }
+        } else if (entry.entryType == TTEntryType::Lower ? entry.valuation >= beta : entry.valuation <= alpha) {
+            return entry.valuation;
+        } else if (!pvNode) { // at PV nodes, a window narrowed to the bound would pass a score failing on it as exact
+            if (entry.entryType == TTEntryType::Lower) {
+                alpha = std::max(alpha, entry.valuation);
+            } else {
+                beta = std::min(beta, entry.valuation);
+            }
+        }
+    }
+
+    std::vector<Move> legalMoves;
+
+    generateAllLegalMoves(game, legalMoves);
+
+    engine::Result result = game.result(legalMoves);
+
+    if (result != engine::Result::Undecided) {
+        int evaluation = 0;
+
+        switch (result) {
+            case engine::Result::CheckMate: {
+                evaluation = MIN_SCORE;
+                evaluation += maxDepth - depth;
+
+                break;
+            }
+            default:
+                break;
+        }
+
+        return evaluation;
+    }
+
+    bool inCheck = game.isAttackedBy(game.getKingSquare(game.getActiveColor()), getOppositeColor(game.getActiveColor()));
+    int staticEvaluation = inCheck ? MIN_SCORE : evaluate(game);
+
+    // reverse futility pruning : far enough above beta, no move is expected to bring the score back under it
+    if (!pvNode && !inCheck && depth <= REVERSE_FUTILITY_DEPTH && !::isMateScore(beta) &&
+        staticEvaluation - REVERSE_FUTILITY_MARGIN * (int)depth >= beta) {
+        return staticEvaluation;
+    }
+
+    // razoring : far below alpha, only captures could help, which quiescence search verifies
+    if (!pvNode && !inCheck && depth <= RAZORING_DEPTH && !::isMateScore(alpha) &&
+        staticEvaluation + RAZORING_MARGIN * (int)depth <= alpha) {
+        int razoringScore = quiesceSearch(game, alpha, alpha + 1, moveCount, orderingMoves);
+
+        if (::searchAborted()) {
+            return 0;
+        }
+
+        if (razoringScore <= alpha) {
+            return razoringScore;
+        }
+    }
+
+    // null move pruning : if passing the turn still fails high at reduced depth, a real move would too.
+    // Not in check, not twice in a row, and not with only king and pawns left (zugzwang)
+    if (!pvNode && !inCheck && !excluding && depth >= NULL_MOVE_DEPTH && ply >= ::nullMoveMinPly && !game.isLastMoveNull() &&
+        !::isMateScore(beta) && hasNonPawnMaterial(game, game.getActiveColor()) &&
+        staticEvaluation >= beta) {
+        unsigned int reduction = NULL_MOVE_REDUCTION + depth / NULL_MOVE_REDUCTION_DIVISOR;
+        unsigned int nullDepth = (depth > reduction + 1) ? depth - reduction - 1 : 0;
+
+        moveCount++;
+
+        MoveSaveState savedState = game.doNullMove();
+        int nullScore = -alphabeta(game, ply + 1 + nullDepth, nullDepth, -beta, -beta + 1, moveCount, orderingMoves, !cutNode);
+        game.undoNullMove(savedState);
+
+        if (::searchAborted()) {
+            return 0;
+        }
+
+        if (nullScore >= beta) {
+            if (::isMateScore(nullScore)) { // don't trust mates found after a null move
+                nullScore = beta;
+            }
+
+            if (depth < NULL_MOVE_VERIFICATION_DEPTH) {
+                return nullScore;
+            }
+
+            // deep nodes are verified by a reduced search without null move on the next plies
+            ::nullMoveMinPly = ply + 3 * nullDepth / 4;
+
+            int verificationScore = alphabeta(game, ply + nullDepth, nullDepth, beta - 1, beta, moveCount, orderingMoves, false);
+
+            ::nullMoveMinPly = 0;
+
+            if (::searchAborted()) {
+                return 0;
+            }
+
+            if (verificationScore >= beta) {
+                return nullScore;
+            }
+        }
+    }
+
+    // ProbCut : captures winning enough material are first tried by quiescence search, then by a reduced search
+    // against the raised beta, unless the transposition table already tells they would fail
+    int probCutBeta = beta + PROBCUT_MARGIN;
+
+    if (!pvNode && !inCheck && !excluding && depth >= PROBCUT_DEPTH && !::isMateScore(beta) &&
+        !(game.getHash() == entry.hash && entry.depth + PROBCUT_REDUCTION >= depth && entry.valuation < probCutBeta)) {
+        unsigned int probCutDepth = depth - 1 - PROBCUT_REDUCTION;
+
+        for (Move &currentMove : legalMoves) {
+            if ((!currentMove.isCapture() && !currentMove.isPromotion()) || staticExchangeEvaluation(game, currentMove) < probCutBeta - staticEvaluation) {
+                continue;
+            }
+
+            moveCount++;
+
+            MoveSaveState savedState = game.doMove(currentMove);
+            int probCutScore = -quiesceSearch(game, -probCutBeta, -probCutBeta + 1, moveCount, orderingMoves);
+
+            if (probCutScore >= probCutBeta) {
+                probCutScore = -alphabeta(game, ply + 1 + probCutDepth, probCutDepth, -probCutBeta, -probCutBeta + 1, moveCount, orderingMoves, !cutNode);
+            }
+
+            game.undoMove(currentMove, savedState);
+
+            if (::searchAborted()) {
+                return 0;
+            }
+
+            if (probCutScore >= probCutBeta) {
+                ::storeEntry(game, currentMove, probCutDepth + 1, probCutScore, probCutBeta - 1, probCutBeta, ply);
+
+                return probCutScore;
+            }
+        }
+    }
+
+    // internal iterative deepening : without a hash move, a reduced depth search provides one
+    if (orderingMoves && !excluding && hashMove.getOriginSquare() >= 64 && depth >= IID_DEPTH && (pvNode || cutNode)) {
+        alphabeta(game, maxDepth - IID_REDUCTION, depth - IID_REDUCTION, alpha, beta, moveCount, orderingMoves, cutNode);
+
+        entry = ::ttable.getEntry(game.getHash());
+        entry.valuation = scoreFromTTable(entry.valuation, ply);
+
+        if (game.getHash() == entry.hash) {
+            hashMove = entry.move;
+        }
+    }
+
+    // singular extension : the hash move is extended if all the other moves fail low by a margin below
+    // its (lower bound) score, in a reduced search excluding it
+    bool singular = false;
+
+    if (!excluding && depth >= SINGULAR_DEPTH && ply < 2 * ::rootDepth && game.getHash() == entry.hash &&
+        entry.move == hashMove && entry.entryType != TTEntryType::Upper && entry.depth + SINGULAR_DEPTH_MARGIN >= depth &&
+        !::isMateScore(entry.valuation)) {
+        int singularBeta = entry.valuation - SINGULAR_MARGIN * (int)depth;
+        unsigned int singularDepth = (depth - 1) / 2;
+        int singularScore = alphabeta(game, ply + singularDepth, singularDepth, singularBeta - 1, singularBeta, moveCount, orderingMoves, cutNode, hashMove);
+
+        if (::searchAborted()) {
+            return 0;
+        }
+
+        singular = singularScore < singularBeta;
+    }
+
+    std::vector<unsigned int> orderedIndices;
+
+    if (orderingMoves) {
+        orderMoves(game, legalMoves, orderedIndices, hashMove, ply);
+    }
+
+    MoveValuation bestMoveValuation = {Move(), MIN_SCORE};
+    std::vector<Move> quietMoves; // quiet moves searched without cutoff
+
+    // futility pruning : at frontier nodes, quiet moves not giving check are skipped when even a margin
+    // over the static evaluation can't reach alpha
+    bool futile = !pvNode && !inCheck && depth <= FUTILITY_DEPTH && !::isMateScore(alpha) &&
+                  staticEvaluation + FUTILITY_MARGIN * (int)depth <= alpha;
+
+    // late move pruning : with moves well ordered, late quiet moves at low depth are rarely better
+    bool lateMovePruning = !pvNode && !inCheck && depth <= LMP_DEPTH && !::isMateScore(alpha) && !::isMateScore(beta);
+    unsigned int quietMovesNumber = 0;
+
+    SearchNode node = {maxDepth, depth, pvNode, cutNode, inCheck, futile, lateMovePruning, singular, orderingMoves, hashMove};
+    bool splitting = ::searchMethod == SearchMethod::YoungBrothersWait && !excluding && depth >= YBW_SPLIT_DEPTH;
+
+    ::clearPV(ply); // searches of this position before the moves (internal iterative deepening) left their line
+
+    for (unsigned int i = 0; i < legalMoves.size(); i++) {
+        Move &currentMove = legalMoves[orderingMoves ? orderedIndices[i] : i];
+
+        if (excluding && currentMove == excludedMove) {
+            continue;
+        }
+
+        bool quiet = !currentMove.isCapture() && !currentMove.isPromotion();
+
+        if (quiet && lateMovePruning && i > 0 && quietMovesNumber >= LMP_BASE + depth * depth) {
+            continue;
+        }
+
+        quietMovesNumber += quiet ? 1 : 0;
+
+        int evaluation;
+
+        if (!searchNodeMove(game, node, currentMove, i, alpha, beta, moveCount, evaluation)) {
+            continue;
+        }
+
+        if (::searchAborted()) { // unfinished, must not reach the transposition table
+            return 0;
+        }
+
+        // failing low returns alpha itself, a later move doing the same is no better than the first one
+        if (evaluation > bestMoveValuation.second || bestMoveValuation.first.getOriginSquare() >= 64) {
+            bestMoveValuation.second = evaluation;
+            bestMoveValuation.first = currentMove;
+        }
+
+        if (pvNode && evaluation > alpha) {
+            ::updatePV(ply, currentMove);
+        }
+
+        alpha = std::max(alpha, evaluation);
+
+        if (alpha >= beta) {
+            if (quiet) {
+                updateHistoryTables(game, currentMove, quietMoves, ply, depth);
+            }
+
+            break;
+        }
+
+        if (quiet) {
+            quietMoves.push_back(currentMove);
+        }
+
+        // young brothers wait : once the eldest brother is searched, the younger ones are shared with the helper threads
+        if (i == 0 && splitting && legalMoves.size() > 1) {
+            std::vector<Move> youngerBrothers;
+
+            for (unsigned int j = 1; j < legalMoves.size(); j++) {
+                youngerBrothers.push_back(legalMoves[orderingMoves ? orderedIndices[j] : j]);
+            }
+
+            if (!splitNode(game, node, youngerBrothers, alpha, beta, quietMovesNumber, bestMoveValuation, quietMoves, moveCount)) {
+                return 0;
+            }
+
+            Move &bestMove = bestMoveValuation.first;
+
+            if (bestMoveValuation.second >= beta && !bestMove.isCapture() && !bestMove.isPromotion()) {
+                updateHistoryTables(game, bestMove, quietMoves, ply, depth);
+            }
+
+            break;
+        }
+    }
+
+    if (!excluding) { // a score without the best move would spoil the entry of this position
+        ::storeEntry(game, bestMoveValuation.first, depth, bestMoveValuation.second, originalAlpha, beta, ply);
+    }
+
+    return bestMoveValuation.second;
+}
+
+// Search every root move (in the given order) to the given depth within the alpha/beta window, and update
+// their scores (exact for the best move, upper bounds for the others). Returns the best move, unless
+// the search got stopped (the result is then meaningless). A score <= alpha or >= beta is only a bound.
+// Without all the root moves (multi PV lines after the first), the result is not the one of the position and must
+// not reach the transposition table
+MoveValuation searchRoot(Game &game, std::vector<RootMove> &rootMoves, unsigned int maxDepth, unsigned int depth, int alpha, int beta, unsigned long long &moveCount, bool orderingMoves, bool storingEntry) {
+    MoveValuation bestMoveValuation = {Move(), MIN_SCORE};
+    int originalAlpha = alpha;
+
+    ::rootDepth = depth;
+
+    for (unsigned int i = 0; i < rootMoves.size(); i++) {
+        RootMove &rootMove = rootMoves[i];
+        Move &currentMove = rootMove.move;
+
+        moveCount++;
+
+        engine::MoveSaveState savedState = game.doMove(currentMove);
+        int moveScore;
+
+        if (i == 0) {
+            moveScore = -alphabeta(game, maxDepth, depth - 1, -beta, -alpha, moveCount, orderingMoves, false);
+        } else {
+            moveScore = -alphabeta(game, maxDepth, depth - 1, -alpha - 1, -alpha, moveCount, orderingMoves, true);
+
+            if (moveScore > alpha && moveScore < beta) {
+                moveScore = -alphabeta(game, maxDepth, depth - 1, -beta, -alpha, moveCount, orderingMoves, false);
+            }
+        }
+
+        game.undoMove(currentMove, savedState);
+
+        if (::stopSearch.load(std::memory_order_relaxed)) {
+            return bestMoveValuation;
+        }
+
+        rootMove.previousScore = rootMove.score;
+        rootMove.score = moveScore;
+
+        if (moveScore > alpha || rootMove.pv.empty()) {
+            ::updatePV(0, currentMove, rootMove.pv);
+        }
+
+        if (moveScore > bestMoveValuation.second || bestMoveValuation.first.getOriginSquare() >= 64) {
+            bestMoveValuation = {currentMove, moveScore};
+        }
+
+        alpha = std::max(alpha, moveScore);
+
+        if (alpha >= beta) {
+            break;
+        }
+    }
+
+    if (storingEntry) {
+        ::ttable.addEntry(game.getHash(), bestMoveValuation.first, depth, bestMoveValuation.second, originalAlpha, beta);
+    }
+
+    return bestMoveValuation;
+}
+
+// Legal moves of the root position, in their guessed order (hash move first)
+static void generateRootMoves(Game &game, std::vector<Move> &legalMoves, std::vector<RootMove> &rootMoves, bool orderingMoves) {
+    std::vector<unsigned int> orderedIndices;
+
+    if (orderingMoves) {
+        TTEntry entry = ::ttable.getEntry(game.getHash());
+
+        orderMoves(game, legalMoves, orderedIndices, game.getHash() == entry.hash ? entry.move : Move());
+    }
+
+    for (unsigned int i = 0; i < legalMoves.size(); i++) {
+        rootMoves.push_back({legalMoves[orderingMoves ? orderedIndices[i] : i], MIN_SCORE, MIN_SCORE, {}});
+    }
+}
+
+MoveValuation negaMax(Game &game, unsigned int maxDepth, unsigned int depth, unsigned long long &moveCount, bool orderingMoves) {
+    MoveValuation bestMoveValuation = {Move(), MIN_SCORE};
+    std::vector<Move> legalMoves;
+
+    generateAllLegalMoves(game, legalMoves);
+
+    engine::Result result = game.result(legalMoves);
+
+    if (result != engine::Result::Undecided) {
+        switch (result) {
+            case engine::Result::Draw: {
+                bestMoveValuation.second = 0;
+                bestMoveValuation.second += (game.getHash() & 0x2) - 1;
+
+                break;
+            }
+            case engine::Result::CheckMate: {
+                bestMoveValuation.second = MIN_SCORE;
+                bestMoveValuation.second += (maxDepth - depth); // distance to mate
+                // DTM should always be 0 here, but I'm keeping it for clarity sake
+
+                break;
+            }
+            default:
+                break;
+        }
+
+        return bestMoveValuation;
+    }
+
+    SearchLimits limits; // fixed depth, nothing else can stop the search
+
+    ::startSearch(limits, game.getActiveColor());
+
+    std::vector<RootMove> rootMoves;
+
+    generateRootMoves(game, legalMoves, rootMoves, orderingMoves);
+
+    return searchRoot(game, rootMoves, maxDepth, depth, MIN_SCORE, MAX_SCORE, moveCount, orderingMoves);
+}
+
+// Search the root in a narrow window around the score of the previous iteration, widening it on each side
+// the search fails, until the score falls inside. Root moves are then sorted for the next iteration.
+static MoveValuation aspirationSearch(Game &game, std::vector<RootMove> &rootMoves, unsigned int depth, int previousScore, unsigned long long &moveCount, bool storingEntry = true) {
+    int delta = ASPIRATION_WINDOW;
+    int alpha = MIN_SCORE, beta = MAX_SCORE;
+
+    if (depth >= ASPIRATION_DEPTH && !::isMateScore(previousScore)) { // no window around mate scores
+        alpha = std::max(previousScore - delta, MIN_SCORE);
+        beta = std::min(previousScore + delta, MAX_SCORE);
+    }
+
+    for (;;) {
+        MoveValuation bestMoveValuation = searchRoot(game, rootMoves, depth, depth, alpha, beta, moveCount, true, storingEntry);
+
+        if (::stopSearch.load(std::memory_order_relaxed)) {
+            return bestMoveValuation;
+        }
+
+        std::stable_sort(rootMoves.begin(), rootMoves.end(), [](const RootMove &a, const RootMove &b) {
+            return a.score > b.score;
+        });
+
+        delta *= 2;
+
+        if (bestMoveValuation.second <= alpha && alpha > MIN_SCORE) { // fail low
+            beta = (alpha + beta) / 2;
+            alpha = std::max(bestMoveValuation.second - delta, MIN_SCORE);
+        } else if (bestMoveValuation.second >= beta && beta < MAX_SCORE) { // fail high
+            beta = std::min(bestMoveValuation.second + delta, MAX_SCORE);
+        } else {
+            return bestMoveValuation;
+        }
+    }
+}
+
+// MTD(f) : the score is only searched with zero windows, each search telling whether it is below or above the
+// tested value, until the lower and upper bounds meet. The transposition table keeps the searches of the same tree
+// cheap. The first value tested is the score of the previous iteration. alphabeta() fails hard, so the bound
+// returned is the tested value itself : the next value is a step away from it, the step doubling while the searches
+// fail on the same side, and halving when they change side.
+// Zero window searches only store bounds and build no line : once the score is known, a last search in a window
+// just around it stores exact entries and gives the principal variation. It costs about one more pass (with the
+// table filled by the previous ones), and its best move is the one played, as with principal variation search.
+static MoveValuation mtdfSearch(Game &game, std::vector<RootMove> &rootMoves, unsigned int depth, int previousScore, unsigned long long &moveCount) {
+    int lowerBound = MIN_SCORE, upperBound = MAX_SCORE;
+    int beta = std::max((previousScore > MIN_SCORE) ? previousScore : evaluate(game), MIN_SCORE + 1);
+    int step = 1, lastSide = 0;
+    MoveValuation bestMoveValuation = {Move(), MIN_SCORE};
+
+    while (lowerBound < upperBound) {
+        MoveValuation searchBest = searchRoot(game, rootMoves, depth, depth, beta - 1, beta, moveCount, true);
+
+        if (::stopSearch.load(std::memory_order_relaxed)) {
+            return searchBest;
+        }
+
+        std::stable_sort(rootMoves.begin(), rootMoves.end(), [](const RootMove &a, const RootMove &b) {
+            return a.score > b.score;
+        });
+
+        int side = (searchBest.second < beta) ? -1 : 1;
+
+        if (side < 0) {
+            upperBound = searchBest.second;
+        } else { // only a fail high proves a move best
+            lowerBound = searchBest.second;
+            bestMoveValuation = searchBest;
+        }
+
+        step = (side == lastSide) ? step * 2 : std::max(step / 2, 1);
+        lastSide = side;
+        beta = (side < 0) ? std::max(upperBound - step + 1, lowerBound + 1) : std::min(lowerBound + step, upperBound);
+    }
+
+    if (bestMoveValuation.first.getOriginSquare() >= 64) { // every search failed low, the best upper bound is the best move
+        bestMoveValuation.first = rootMoves[0].move;
+    }
+
+    bestMoveValuation.second = lowerBound;
+
+    int alpha = std::max(lowerBound - 1, MIN_SCORE), finalBeta = std::min(lowerBound + 1, MAX_SCORE);
+    MoveValuation pvBest = searchRoot(game, rootMoves, depth, depth, alpha, finalBeta, moveCount, true);
+
+    if (::stopSearch.load(std::memory_order_relaxed)) {
+        return pvBest;
+    }
+
+    std::stable_sort(rootMoves.begin(), rootMoves.end(), [](const RootMove &a, const RootMove &b) {
+        return a.score > b.score;
+    });
+
+    if (pvBest.second > alpha && pvBest.second < finalBeta) { // unless the table changed the result (search instability)
+        bestMoveValuation = pvBest;
+    }
+
+    return bestMoveValuation;
+}
+
+// One iteration of the root search, with the driver of the search method
+static MoveValuation iterationSearch(Game &game, std::vector<RootMove> &rootMoves, unsigned int depth, int previousScore, unsigned long long &moveCount) {
+    if (::searchMethod == SearchMethod::MTDf) {
+        return mtdfSearch(game, rootMoves, depth, previousScore, moveCount);
+    }
+
+    return aspirationSearch(game, rootMoves, depth, previousScore, moveCount);
+}
+
+// Principal variation found for a root move by the last search of the root
+static std::vector<Move> rootMovePV(std::vector<RootMove> &rootMoves, Move &move) {
+    for (RootMove &rootMove : rootMoves) {
+        if (rootMove.move == move) {
+            return rootMove.pv;
+        }
+    }
+
+    return {move};
+}
+
+// Best move, principal variation and node count of a lazy SMP helper thread
+struct HelperResult {
+    MoveValuation bestMoveValuation;
+    unsigned int completedDepth;
+    unsigned long long moveCount;
+    std::vector<Move> pv;
+};
+
+// Iterative deepening of a helper thread on its own copy of the root position (and its own history tables),
+// until the main thread stops the search. Helpers start on alternate depths, so they don't all search the
+// same iteration in the same order, and share what they find through the transposition table.
+static void helperSearch(Game &rootGame, unsigned int index, unsigned int maxDepth, HelperResult &result) {
+    Game game = rootGame;
+    std::vector<Move> legalMoves;
+    std::vector<RootMove> rootMoves;
+
+    ageHistoryTables();
+    generateAllLegalMoves(game, legalMoves);
+    generateRootMoves(game, legalMoves, rootMoves, true);
+
+    result = {{rootMoves[0].move, MIN_SCORE}, 0, 0, {}};
+
+    for (unsigned int depth = 1 + (index + 1) % 2; depth <= maxDepth; depth++) {
+        MoveValuation iterationBest = iterationSearch(game, rootMoves, depth, result.bestMoveValuation.second, result.moveCount);
+
+        if (::stopSearch.load(std::memory_order_relaxed)) {
+            break;
+        }
+
+        result.bestMoveValuation = iterationBest;
+        result.completedDepth = depth;
+        result.pv = rootMovePV(rootMoves, iterationBest.first);
+    }
+}
+
+// Ask the running search to stop, it returns the best move of its last completed iteration
+void stopSearching() {
+    ::stopSearch = true;
+}
+
+// Stop request of the searches this thread runs, read when each of them starts (nullptr for none)
+void setStopRequest(std::atomic<bool> *request) {
+    ::stopRequest = request;
+}
+
+void resetSearchProgress() {
+    std::lock_guard<std::mutex> lock(::progressMutex);
+
+    ::searchProgress = {0, 0, {Move(), MIN_SCORE}};
+    ::searchedNodes = 0;
+}
+
+// Turn the running ponder search into the search of the move to play, under the given limits
+void ponderHit(SearchLimits &limits) {
+    std::lock_guard<std::mutex> lock(::ponderMutex);
+
+    ::ponderHitLimits = limits;
+    ::ponderHitPending = true;
+}
+
+// Forget a ponder hit which came too late for the previous search, before a new one starts
+void cancelPonderHit() {
+    std::lock_guard<std::mutex> lock(::ponderMutex);
+
+    ::ponderHitPending = false;
+}
+
+SearchProgress getSearchProgress() {
+    std::lock_guard<std::mutex> lock(::progressMutex);
+    SearchProgress progress = ::searchProgress;
+
+    progress.nodes = std::max(progress.nodes, ::searchedNodes.load(std::memory_order_relaxed));
+
+    return progress;
+}
+
+ThreadPool &getSearchThreadPool() {
+    return ::threadPool;
+}
+
+void beginSearch(SearchLimits &limits, Color color) {
+    ::startSearch(limits, color);
+}
+
+// Searchers without iterations stop at the soft limit, the main search thread checks it on every call
+bool searchLimitReached(unsigned long long moveCount) {
+    if (::searchStopped(moveCount)) {
+        return true;
+    }
+
+    if (::mainSearchThread) {
+        ::applyPonderHit();
+        ::searchedNodes.store(moveCount, std::memory_order_relaxed);
+
+        if ((::searchLimits.nodes > 0 && moveCount >= ::searchLimits.nodes) || ::timeManager.softLimitReached()) {
+            ::stopSearch = true;
+        }
+    }
+
+    return ::stopSearch.load(std::memory_order_relaxed);
+}
+
+void publishSearchProgress(SearchProgress &progress) {
+    std::lock_guard<std::mutex> lock(::progressMutex);
+
+    ::searchProgress = progress;
+}
+
+void setSearchMethod(SearchMethod method) {
+    ::searchMethod = method;
+}
+
+SearchMethod getSearchMethod() {
+    return ::searchMethod;
+}
+
+void setSearchThreads(unsigned int threads) {
+    ::threadPool.resize(std::min(std::max(threads, 1U), MAX_SEARCH_THREADS) - 1);
+}
+
+unsigned int getSearchThreads() {
+    return ::threadPool.getSize() + 1;
+}
+
+// Search deeper and deeper until one of the limits is reached. The best move of the last completed
+// iteration is returned, and the root moves are reordered by score between iterations.
+// A ponder search has no limit until a ponder hit gives it the real ones.
+MoveValuation iterativeDeepening(Game &game, SearchLimits &limits, unsigned long long &moveCount, unsigned int &completedDepth) {
+    std::vector<Move> legalMoves;
+
+    completedDepth = 0;
+    generateAllLegalMoves(game, legalMoves);
+
+    if (game.result(legalMoves) != engine::Result::Undecided) { // nothing to search
+        return negaMax(game, 1, 1, moveCount);
+    }
+
+    ::startSearch(limits, game.getActiveColor());
+
+    std::vector<RootMove> rootMoves;
+
+    generateRootMoves(game, legalMoves, rootMoves, true);
+
+    MoveValuation bestMoveValuation = {rootMoves[0].move, MIN_SCORE}; // always have a move to play
+    std::vector<Move> pv;
+    unsigned int maxDepth = (limits.depth > 0) ? std::min(limits.depth, MAX_DEPTH) : MAX_DEPTH;
+    unsigned int stableIterations = 0;
+    unsigned long long previousIterationTime = 0;
+
+    // lazy SMP : helper threads search the same root at the same time, copied before the main thread moves pieces.
+    // With young brothers wait, they share the nodes of the main thread search instead
+    Game rootGame = game;
+    std::vector<HelperResult> helperResults;
+
+    if (::searchMethod == SearchMethod::YoungBrothersWait) {
+        ::threadPool.start([](unsigned int) {
+            youngBrothersWaitHelper();
+        });
+    } else {
+        helperResults.resize(::threadPool.getSize());
+        ::threadPool.start([&rootGame, &helperResults, maxDepth](unsigned int index) {
+            helperSearch(rootGame, index, maxDepth, helperResults[index]);
+        });
+    }
+
+    for (unsigned int depth = 1; depth <= maxDepth; depth++) {
+        if (::searchLimits.depth > 0 && depth > ::searchLimits.depth) { // depth limit given by a ponder hit
+            break;
+        }
+
+        unsigned long long iterationStart = ::timeManager.elapsed();
+        MoveValuation iterationBest = iterationSearch(game, rootMoves, depth, bestMoveValuation.second, moveCount);
+        unsigned long long iterationTime = ::timeManager.elapsed() - iterationStart;
+
+        if (::stopSearch.load(std::memory_order_relaxed)) { // incomplete iteration
+            break;
+        }
+
+        stableIterations = (iterationBest.first == bestMoveValuation.first) ? stableIterations + 1 : 0;
+        bestMoveValuation = iterationBest;
+        completedDepth = depth;
+        pv = rootMovePV(rootMoves, bestMoveValuation.first);
+
+        {
+            std::lock_guard<std::mutex> lock(::progressMutex);
+
+            ::searchProgress = {completedDepth, moveCount, bestMoveValuation};
+        }
+
+        ::applyPonderHit();
+
+        if (::searchLimits.infinite || ::searchLimits.ponder) {
+            continue;
+        }
+
+        if (std::abs(bestMoveValuation.second) >= MAX_SCORE - (int)depth) { // mate found, can't find a shorter one deeper
+            break;
+        }
+
+        if (!::timeManager.isTimed()) {
+            continue;
+        }
+
+        if (rootMoves.size() == 1) { // forced move, don't waste time on it
+            break;
+        }
+
+        if (depth >= EASY_MOVE_DEPTH && rootMoves[0].score - rootMoves[1].score >= EASY_MOVE_MARGIN &&
+            ::timeManager.elapsed() >= ::timeManager.getSoftLimit() / EASY_MOVE_TIME_DIVISOR) { // one move clearly best
+            break;
+        }
+
+        if (stableIterations == 0) {
+            ::timeManager.adjust(UNSTABLE_TIME_FACTOR);
+        } else if (stableIterations >= STABLE_ITERATIONS) {
+            ::timeManager.adjust(STABLE_TIME_FACTOR);
+        } else {
+            ::timeManager.adjust(1.0);
+        }
+
+        if (::timeManager.softLimitReached()) {
+            break;
+        }
+
+        // next iteration would most likely be aborted by the hard limit, don't start it
+        unsigned long long branchingFactor = (previousIterationTime > 0) ? iterationTime / previousIterationTime : MAX_BRANCHING_FACTOR;
+
+        branchingFactor = std::min(std::max(branchingFactor, MIN_BRANCHING_FACTOR), MAX_BRANCHING_FACTOR);
+        previousIterationTime = std::max(iterationTime, 1ULL);
+
+        if (::timeManager.elapsed() + iterationTime * branchingFactor > ::timeManager.getHardLimit()) {
+            break;
+        }
+    }
+
+    ::stopSearch = true;
+    wakeHelpers();
+    ::threadPool.wait();
+
+    // a helper having completed a deeper iteration has the better move
+    for (HelperResult &helperResult : helperResults) {
+        moveCount += helperResult.moveCount;
+
+        if (helperResult.completedDepth > completedDepth) {
+            bestMoveValuation = helperResult.bestMoveValuation;
+            completedDepth = helperResult.completedDepth;
+            pv = helperResult.pv;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(::progressMutex);
+
+        ::searchPV = pv;
+        ::searchPVHash = game.getHash();
+    }
+
+    return bestMoveValuation;
+}
+
+// Moves expected to be played from the position, starting with the given move : the principal variation of the
+// last search when it searched this position and found this move, then the moves of exact transposition table
+// entries, as long as they are legal and don't repeat a position
+void principalVariation(Game &game, Move firstMove, unsigned int maxLength, std::vector<Move> &moves) {
+    std::vector<Move> line;
+
+    {
+        std::lock_guard<std::mutex> lock(::progressMutex);
+
+        if (::searchPVHash == game.getHash() && !::searchPV.empty() && ::searchPV[0] == firstMove) {
+            line = ::searchPV;
+        }
+    }
+
+    if (line.empty()) {
+        line.push_back(firstMove);
+    }
+
+    ::followLine(game, line, maxLength, moves);
+}
+
+// Iterative deepening giving the best lines moves instead of only the best move, each with an exact score and
+// its principal variation. At each depth, the best move is searched among all the root moves, then the second
+// best among the others, and so on. Runs on the calling thread only.
+std::vector<PVLine> multiPVSearch(Game &game, SearchLimits &limits, unsigned int lines, unsigned long long &moveCount, unsigned int &completedDepth) {
+    std::vector<PVLine> variations;
+    std::vector<Move> legalMoves;
+
+    completedDepth = 0;
+    generateAllLegalMoves(game, legalMoves);
+
+    if (game.result(legalMoves) != engine::Result::Undecided) { // nothing to search
+        return variations;
+    }
+
+    ::startSearch(limits, game.getActiveColor());
+
+    std::vector<RootMove> rootMoves;
+
+    generateRootMoves(game, legalMoves, rootMoves, true);
+
+    unsigned int maxDepth = (limits.depth > 0) ? std::min(limits.depth, MAX_DEPTH) : MAX_DEPTH;
+
+    lines = std::min(std::max(lines, 1U), (unsigned int)rootMoves.size());
+
+    for (unsigned int depth = 1; depth <= maxDepth; depth++) {
+        std::vector<RootMove> iterationMoves = rootMoves;
+
+        for (unsigned int line = 0; line < lines && !::stopSearch.load(std::memory_order_relaxed); line++) {
+            std::vector<RootMove> remainingMoves(iterationMoves.begin() + line, iterationMoves.end());
+
+            aspirationSearch(game, remainingMoves, depth, remainingMoves[0].score, moveCount, line == 0); // the other lines leave moves out
+            std::copy(remainingMoves.begin(), remainingMoves.end(), iterationMoves.begin() + line);
+        }
+
+        if (::stopSearch.load(std::memory_order_relaxed)) { // incomplete iteration
+            break;
+        }
+
+        rootMoves = iterationMoves;
+        completedDepth = depth;
+
+        if (!limits.infinite && ::timeManager.softLimitReached()) {
+            break;
+        }
+    }
+
+    for (unsigned int line = 0; line < lines; line++) {
+        variations.push_back({rootMoves[line].score, rootMoves[line].pv});
+    }
+
+    return variations;
+}
+
+}
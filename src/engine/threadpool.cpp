@@ -0,0 +1,113 @@
+#include "include/threadpool.hpp"
+
+namespace engine {
+
+ThreadPool::ThreadPool() : generation(0), running(0), quit(false) {}
+
+ThreadPool::~ThreadPool() {
+    this->stopThreads();
+}
+
+// A new thread starts from the current generation, it must not run the previous job again
+void ThreadPool::workerLoop(unsigned int index, unsigned long long lastGeneration) {
+    for (;;) {
+        std::function<void(unsigned int)> currentJob;
+
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+
+            this->jobReady.wait(lock, [&]() { return this->quit || this->generation != lastGeneration; });
+
+            if (this->quit) {
+                return;
+            }
+
+            lastGeneration = this->generation;
+            currentJob = this->job;
+        }
+
+        currentJob(index);
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+
+            if (--this->running == 0) {
+                this->jobDone.notify_all();
+            }
+        }
+    }
+}
+
+void ThreadPool::stopThreads() {
+    this->wait();
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        this->quit = true;
+    }
+
+    this->jobReady.notify_all();
+
+    for (std::thread &thread : this->threads) {
+        thread.join();
+    }
+
+    this->threads.clear();
+    this->quit = false;
+}
+
+// Only between jobs : running threads are joined and new ones are started
+void ThreadPool::resize(unsigned int size) {
+    if (size == this->threads.size()) {
+        return;
+    }
+
+    this->stopThreads();
+
+    for (unsigned int index = 0; index < size; index++) {
+        this->threads.emplace_back(&ThreadPool::workerLoop, this, index, this->generation);
+    }
+}
+
+unsigned int ThreadPool::getSize() {
+    return this->threads.size();
+}
+
+// Run the job on every thread, without waiting for it to finish
+void ThreadPool::start(std::function<void(unsigned int)> job) {
+    if (this->threads.empty()) {
+        return;
+    }
+
+    this->wait();
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        this->job = job;
+        this->running = this->threads.size();
+        this->generation++;
+    }
+
+    this->jobReady.notify_all();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    this->jobDone.wait(lock, [&]() { return this->running == 0; });
+}
+
+// Park a thread of the running job until ready() holds, instead of spinning. The lock is the one of the job's own
+// work queue : it is held when ready() is called, and must be taken by the threads changing what ready() reads
+// before they notify.
+void ThreadPool::waitForWork(std::unique_lock<std::mutex> &lock, std::function<bool()> ready) {
+    this->workReady.wait(lock, ready);
+}
+
+void ThreadPool::notifyWork() {
+    this->workReady.notify_all();
+}
+
+} // namespace engine
@@ -0,0 +1,69 @@
+#include "include/timemanagement.hpp"
+#include <algorithm>
+
+namespace engine {
+
+TimeManager::TimeManager() : start(std::chrono::steady_clock::now()), timed(false), softLimit(0), hardLimit(0), optimalLimit(0) {}
+
+// Compute the soft and hard deadlines of a search from its limits, for the side to move
+void TimeManager::init(SearchLimits &limits, Color color) {
+    this->start = std::chrono::steady_clock::now();
+    this->timed = false;
+
+    if (limits.infinite || limits.ponder) {
+        return;
+    }
+
+    if (limits.moveTime > 0) { // the whole time can be used, no need to keep some for next iterations
+        unsigned long long moveTime = std::max(1, (int)limits.moveTime - MOVE_OVERHEAD);
+
+        this->timed = true;
+        this->optimalLimit = this->softLimit = this->hardLimit = moveTime;
+
+        return;
+    }
+
+    if (limits.time[color] > 0) {
+        unsigned long long remaining = std::max(1, (int)limits.time[color] - MOVE_OVERHEAD);
+        unsigned long long movesToGo = (limits.movesToGo > 0) ? std::min(limits.movesToGo, (unsigned int)DEFAULT_MOVES_TO_GO) : DEFAULT_MOVES_TO_GO;
+        unsigned long long increment = limits.increment[color];
+
+        this->timed = true;
+        this->optimalLimit = std::min(remaining, remaining / movesToGo + increment * 3 / 4);
+        this->hardLimit = std::min(remaining / HARD_LIMIT_CLOCK_RATIO + increment, this->optimalLimit * HARD_LIMIT_FACTOR);
+        this->hardLimit = std::max(std::min(this->hardLimit, remaining), this->optimalLimit);
+        this->softLimit = this->optimalLimit;
+    }
+}
+
+// Scale the soft limit (more time when the best move is unstable, less when it is settled),
+// without ever going past the hard limit
+void TimeManager::adjust(double factor) {
+    this->softLimit = std::min((unsigned long long)(this->optimalLimit * factor), this->hardLimit);
+}
+
+bool TimeManager::isTimed() {
+    return this->timed;
+}
+
+unsigned long long TimeManager::elapsed() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - this->start).count();
+}
+
+unsigned long long TimeManager::getSoftLimit() {
+    return this->softLimit;
+}
+
+unsigned long long TimeManager::getHardLimit() {
+    return this->hardLimit;
+}
+
+bool TimeManager::softLimitReached() {
+    return this->timed && this->elapsed() >= this->softLimit;
+}
+
+bool TimeManager::hardLimitReached() {
+    return this->timed && this->elapsed() >= this->hardLimit;
+}
+
+} // namespace engine
@@ -1,29 +1,256 @@
 #include "include/transpositiontable.hpp"
+#include "include/memory.hpp"
 #include "include/zobrist.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+// the slots may be shared by several processes, atomics must not rely on a process local lock
+static_assert(std::atomic<engine::Key>::is_always_lock_free, "TTable slots require lock-free 64 bits atomics");
+
+// data layout of a slot (54 bits used) :
+// origin square (7) | target square (7) | flags (10) | captured piece type (3) | captured piece color (1)
+// | depth (8) | entry type (2) | valuation (16)
+#define TT_ORIGIN_SHIFT     0
+#define TT_TARGET_SHIFT     7
+#define TT_FLAGS_SHIFT      14
+#define TT_CAPTURED_SHIFT   24
+#define TT_COLOR_SHIFT      27
+#define TT_DEPTH_SHIFT      28
+#define TT_TYPE_SHIFT       36
+#define TT_VALUATION_SHIFT  38
+
+static unsigned long long packEntry(engine::Move &move, unsigned int depth, engine::TTEntryType entryType, int valuation) {
+    unsigned long long data = 0;
+
+    data |= (unsigned long long)(move.getOriginSquare() & 0x7f) << TT_ORIGIN_SHIFT;
+    data |= (unsigned long long)(move.getTargetSquare() & 0x7f) << TT_TARGET_SHIFT;
+    data |= (unsigned long long)(move.getFlags() & 0x3ff) << TT_FLAGS_SHIFT;
+    data |= (unsigned long long)(move.getCapturedPiece().pieceType & 0x7) << TT_CAPTURED_SHIFT;
+    data |= (unsigned long long)(move.getCapturedPiece().color & 0x1) << TT_COLOR_SHIFT;
+    data |= (unsigned long long)(depth > 0xff ? 0xff : depth) << TT_DEPTH_SHIFT;
+    data |= (unsigned long long)(entryType & 0x3) << TT_TYPE_SHIFT;
+    data |= (unsigned long long)(unsigned short)(short)valuation << TT_VALUATION_SHIFT;
+
+    return data;
+}
+
+static engine::TTEntry unpackEntry(unsigned long long data) {
+    engine::TTEntry entry;
+    engine::Piece capturedPiece = {
+        (engine::PieceType)((data >> TT_CAPTURED_SHIFT) & 0x7),
+        (engine::Color)((data >> TT_COLOR_SHIFT) & 0x1),
+    };
+
+    entry.move = engine::Move((data >> TT_ORIGIN_SHIFT) & 0x7f, (data >> TT_TARGET_SHIFT) & 0x7f, (data >> TT_FLAGS_SHIFT) & 0x3ff, capturedPiece);
+    entry.depth = (data >> TT_DEPTH_SHIFT) & 0xff;
+    entry.entryType = (engine::TTEntryType)((data >> TT_TYPE_SHIFT) & 0x3);
+    entry.valuation = (short)((data >> TT_VALUATION_SHIFT) & 0xffff);
+
+    return entry;
+}
+
+static std::string shmName(const std::string &name) {
+    if (name.size() > 0 && name[0] == '/') {
+        return name;
+    }
+
+    return "/" + name;
+}
 
 namespace engine {
 
+TTable::TTable() : table(nullptr), size(0) {
+    this->computeSize();
+    this->mapPrivate();
+}
+
+TTable::~TTable() {
+    this->unmap();
+}
+
+// Largest power of 2 number of slots fitting in the table share of the memory budget
+void TTable::computeSize() {
+    size_t budget = getTableBudget(TTABLE_NAME);
+
+    this->size = 1;
+
+    while (this->size * 2 * sizeof(TTSlot) <= budget) {
+        this->size *= 2;
+    }
+}
+
+int TTable::mapPrivate() {
+    this->table = static_cast<TTSlot *>(allocateTable(TTABLE_NAME, this->size * sizeof(TTSlot)));
+
+    if (this->table == nullptr) {
+        std::cerr << "[ERROR] Could not allocate transposition table" << std::endl;
+
+        return -1;
+    }
+
+    return 0;
+}
+
+void TTable::unmap() {
+    if (this->table != nullptr) {
+        freeTable(this->table);
+        this->table = nullptr;
+    }
+
+    this->sharedName.clear();
+}
+
+// Attach the table to the named POSIX shared memory segment, creating it if needed.
+// Every process opening the same name shares the same entries (zobrist keys are generated
+// from a fixed seed, so hashes agree between processes). If the segment can't be mapped, a private table is used.
+int TTable::openShared(const std::string &name) {
+    std::string segmentName = shmName(name);
+    size_t segmentSize = this->size * sizeof(TTSlot);
+
+    int fd = shm_open(segmentName.c_str(), O_RDWR | O_CREAT, 0600);
+
+    if (fd == -1) {
+        std::cerr << "[ERROR] Could not open shared transposition table '" << segmentName << "' : " << strerror(errno) << std::endl;
+
+        return -1;
+    }
+
+    struct stat segmentStat;
+
+    if (fstat(fd, &segmentStat) == -1) {
+        std::cerr << "[ERROR] Could not stat shared transposition table '" << segmentName << "' : " << strerror(errno) << std::endl;
+        close(fd);
+
+        return -1;
+    }
+
+    if (segmentStat.st_size == 0) { // first process to open it, zero filled by ftruncate
+        if (ftruncate(fd, segmentSize) == -1) {
+            std::cerr << "[ERROR] Could not size shared transposition table '" << segmentName << "' : " << strerror(errno) << std::endl;
+            close(fd);
+
+            return -1;
+        }
+    } else if ((size_t)segmentStat.st_size != segmentSize) {
+        std::cerr << "[ERROR] Shared transposition table '" << segmentName << "' has size " << segmentStat.st_size
+                  << " (expected " << segmentSize << ")" << std::endl;
+        close(fd);
+
+        return -1;
+    }
+
+    this->unmap(); // release the current table first, both must not be counted in the budget at once
+    this->table = static_cast<TTSlot *>(allocateTable(TTABLE_NAME, segmentSize, fd));
+    close(fd); // the mapping keeps the segment alive
+
+    if (this->table == nullptr) {
+        std::cerr << "[ERROR] Could not map shared transposition table '" << segmentName << "'" << std::endl;
+        this->mapPrivate();
+
+        return -1;
+    }
+
+    this->sharedName = segmentName;
+
+    return 0;
+}
+
+// Detach from any shared segment and go back to a fresh private table
+int TTable::openPrivate() {
+    this->unmap();
+
+    return this->mapPrivate();
+}
+
+// Resize the table after a change of the memory budget, a shared table is reattached to its segment,
+// which only succeeds if the other processes use the same budget
+int TTable::resize() {
+    std::string name = this->sharedName;
+
+    this->unmap();
+    this->computeSize();
+
+    if (name.size() > 0) {
+        int status = this->openShared(name);
+
+        if (this->table == nullptr) {
+            this->mapPrivate();
+        }
+
+        return status;
+    }
+
+    return this->mapPrivate();
+}
+
+// Remove the named segment, processes still attached keep their mapping until they detach
+int TTable::removeShared(const std::string &name) {
+    std::string segmentName = shmName(name);
+
+    if (shm_unlink(segmentName.c_str()) == -1) {
+        std::cerr << "[ERROR] Could not remove shared transposition table '" << segmentName << "' : " << strerror(errno) << std::endl;
+
+        return -1;
+    }
+
+    return 0;
+}
+
+size_t TTable::getSize() {
+    return this->size;
+}
+
+bool TTable::isShared() {
+    return this->sharedName.size() > 0;
+}
+
+const std::string &TTable::getSharedName() {
+    return this->sharedName;
+}
+
 TTEntry TTable::getEntry(Key &key) {
-    return this->table[key % TTABLE_SIZE];
+    if (this->table == nullptr) {
+        TTEntry entry = unpackEntry(0);
+        entry.hash = ~key;
+
+        return entry;
+    }
+
+    TTSlot &slot = this->table[key & (this->size - 1)];
+    unsigned long long data = slot.data.load(std::memory_order_relaxed);
+    Key check = slot.check.load(std::memory_order_relaxed);
+
+    TTEntry entry = unpackEntry(data);
+    entry.hash = check ^ data; // only equal to key if the slot was written as a whole for this position
+
+    return entry;
 }
 
 void TTable::addEntry(Key &key, Move &move, unsigned int depth, int valuation, int alpha, int beta) {
-    TTEntry entry;
+    if (this->table == nullptr) {
+        return;
+    }
 
-    entry.move = move;
-    entry.depth = depth;
-    entry.valuation = valuation;
-    entry.hash = key;
+    TTEntryType entryType;
 
     if (valuation >= beta) {
-        entry.entryType = TTEntryType::Lower;
+        entryType = TTEntryType::Lower;
     } else if (valuation <= alpha) {
-        entry.entryType = TTEntryType::Upper;
+        entryType = TTEntryType::Upper;
     } else {
-        entry.entryType = TTEntryType::Exact;
+        entryType = TTEntryType::Exact;
     }
 
-    this->table[key % TTABLE_SIZE] = entry;
+    unsigned long long data = packEntry(move, depth, entryType, valuation);
+    TTSlot &slot = this->table[key & (this->size - 1)];
+
+    slot.check.store(key ^ data, std::memory_order_relaxed);
+    slot.data.store(data, std::memory_order_relaxed);
 }
 
-} // namespace engine
\ No newline at end of file
+} // namespace engine
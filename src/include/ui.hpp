@@ -18,7 +18,7 @@
 namespace ui {
 
 int init(const std::string windowTitle, const unsigned int boardRectangleWidth, const float scale);
-int manageEvents();
+int manageEvents(bool wait = true);
 unsigned int handlePromotion(engine::Color pieceColor, unsigned int targetSquare);
 int clear();
 int renderSquare(unsigned int squareId);
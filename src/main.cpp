@@ -1,3 +1,4 @@
+#include "engine/include/asyncsearch.hpp"
 #include "engine/include/evaluation.hpp"
 #include "engine/include/piece.hpp"
 #include "engine/include/utils.hpp"
@@ -5,12 +6,16 @@
 #include "engine/include/search.hpp"
 #include "engine/include/engine.hpp"
 #include "engine/include/movesgeneration.hpp"
+#include <chrono>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 #define BOARD_RECTANGLE_WIDTH 45
-#define SEARCH_DEPTH 6
+#define SEARCH_MOVE_TIME 3000 // ms
+#define EVENT_POLL_INTERVAL 10 // ms, between two polls of the window events while the AI thinks
 
 int main() {
     std::string title("Chess engine v");
@@ -31,6 +36,12 @@ int main() {
     std::vector<engine::MoveSaveState> savedStates;
     std::vector<engine::Move> savedMoves;
     engine::MoveValuation bestMoveValuation = {engine::Move(), 0xc0ffee};
+    std::unique_ptr<engine::SearchHandle> search; // search of the current position, or ponder search on the player turn
+    engine::Move ponderMove; // player move expected by the AI, searched in advance while the player thinks
+    bool pondering = false;
+    engine::SearchLimits limits;
+
+    limits.moveTime = SEARCH_MOVE_TIME;
 
     ui::init(title, BOARD_RECTANGLE_WIDTH, 3.0f);
 
@@ -69,9 +80,24 @@ int main() {
         ui::renderCapturedPieces(1, game.getCapturedPieces(engine::Color::White));
         ui::show();
 
-        if (bestMoveValuation.second == 0xc0ffee) {
-            unsigned long long moveCount = 0;
-            bestMoveValuation = engine::negaMax(game, SEARCH_DEPTH, SEARCH_DEPTH, moveCount, true);
+        if (bestMoveValuation.second == 0xc0ffee && !search) {
+            if (game.getActiveColor() == engine::Color::Black) {
+                search = std::make_unique<engine::SearchHandle>(game, limits);
+            } else if (ponderMove != engine::Move()) { // think on the player time, as if the expected move was played
+                engine::Game ponderGame = game;
+                engine::SearchLimits ponderLimits = limits;
+
+                ponderGame.doMove(ponderMove);
+                ponderLimits.ponder = true;
+                search = std::make_unique<engine::SearchHandle>(ponderGame, ponderLimits);
+                pondering = true;
+            }
+        }
+
+        if (search && !pondering && search->isFinished()) {
+            bestMoveValuation = search->wait();
+            std::cout << "Searched " << search->getMoveCount() << " nodes to depth " << search->getCompletedDepth() << std::endl;
+            search.reset();
             std::cout << "AI move : " << game.move2str(bestMoveValuation.first) << " with valuation " << bestMoveValuation.second / 100.f << std::endl;
             std::cout << "AI move : " << utils::caseNameFromId(bestMoveValuation.first.getOriginSquare()) << utils::caseNameFromId(bestMoveValuation.first.getTargetSquare()) << std::endl;
             if (abs(bestMoveValuation.second) >= engine::MAX_SCORE - 256) {
@@ -80,12 +106,27 @@ int main() {
         }
 
         if (game.getActiveColor() == engine::Color::Black) { // AI turn
+            if (search) { // still thinking : the window keeps handling its events, the move is played once the search is finished
+                if (ui::manageEvents(false) == ERROR_EVENT) {
+                    inGame = false;
+                }
+
+                std::this_thread::sleep_for(std::chrono::milliseconds(EVENT_POLL_INTERVAL));
+
+                continue;
+            }
+
             selected = false;
             selectedCaseId = 64;
             selectedMoves.clear();
 
             bestMoveValuation.second = 0xc0ffee;
 
+            std::vector<engine::Move> expectedMoves;
+
+            engine::principalVariation(game, bestMoveValuation.first, 2, expectedMoves);
+            ponderMove = (expectedMoves.size() > 1) ? expectedMoves[1] : engine::Move();
+
             savedMoves.push_back(bestMoveValuation.first);
             savedStates.push_back(game.doMove(bestMoveValuation.first));
 
@@ -127,6 +168,14 @@ int main() {
                                 move.setFlags(promotedPieceFlag);
                             }
 
+                            if (pondering && move == ponderMove) { // ponder hit, the search goes on for the AI move
+                                search->ponderHit(limits);
+                            } else {
+                                search.reset(); // searching a position which is gone
+                            }
+
+                            pondering = false;
+
                             savedMoves.push_back(move);
                             savedStates.push_back(game.doMove(move));
 
@@ -151,6 +200,10 @@ int main() {
                     }
                 }
             } else if (event == PMOVE_EVENT && savedStates.size() > 0) {
+                search.reset();
+                pondering = false;
+                ponderMove = engine::Move();
+                bestMoveValuation.second = 0xc0ffee;
                 selected = false;
                 selectedMoves.clear();
 
@@ -36,14 +36,16 @@ int init(const std::string windowTitle, const unsigned int boardRectangleWidth,
     return ::currentWindow.isOpen();
 }
 
-int manageEvents() {
+// Wait for the next event, or only take a pending one (INVALID_EVENT if there is none) so the caller can do
+// something else meanwhile
+int manageEvents(bool wait) {
     if (!::currentWindow.isOpen()) {
         return ERROR_EVENT;
     }
 
     sf::Event event;
 
-    if (::currentWindow.waitEvent(event)) {
+    if (wait ? ::currentWindow.waitEvent(event) : ::currentWindow.pollEvent(event)) {
         switch (event.type) {
             case sf::Event::Closed: {
                 close();
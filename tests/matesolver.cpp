@@ -0,0 +1,80 @@
+#include "../src/engine/include/engine.hpp"
+#include "../src/engine/include/matesolver.hpp"
+#include "../src/engine/include/movesgeneration.hpp"
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Mate solver on positions with a known mate (or none) : the status, the number of moves, and a mating line
+// that is legal, of that many moves, and ends in checkmate
+struct MateCase {
+    std::string fen;
+    unsigned int maxMoves;
+    unsigned long long maxNodes;
+    engine::MateStatus status;
+    unsigned int moves; // of the mate, when proven
+};
+
+static bool checkLine(const std::string &fen, engine::MateResult &result) {
+    engine::Game game(fen);
+
+    if (result.line.size() != 2 * result.moves - 1) {
+        return false;
+    }
+
+    for (engine::Move &move : result.line) {
+        std::vector<engine::Move> legalMoves;
+
+        engine::generateAllLegalMoves(game, legalMoves);
+
+        if (std::find(legalMoves.begin(), legalMoves.end(), move) == legalMoves.end()) {
+            return false;
+        }
+
+        game.doMove(move);
+    }
+
+    std::vector<engine::Move> legalMoves;
+
+    engine::generateAllLegalMoves(game, legalMoves);
+
+    return game.result(legalMoves) == engine::Result::CheckMate;
+}
+
+int main() {
+    std::vector<MateCase> cases = {
+        {"6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1", 1, 0, engine::MateStatus::Proven, 1},           // back rank
+        {"r5k1/8/8/8/8/8/5PPP/6K1 b - - 0 1", 3, 0, engine::MateStatus::Proven, 1},           // for black, within a larger bound
+        {"r5rk/5p1p/5R2/4B3/8/8/7P/7K w - - 0 1", 2, 0, engine::MateStatus::Disproven, 0},    // a mate in 3...
+        {"r5rk/5p1p/5R2/4B3/8/8/7P/7K w - - 0 1", 3, 0, engine::MateStatus::Proven, 3},       // ...found in 3
+        {"8/8/8/8/8/2k5/8/KQ6 w - - 0 1", 12, 0, engine::MateStatus::Proven, 6},              // KQK, shortened from the bound
+        {"k7/8/1Q6/8/8/8/8/7K b - - 0 1", 4, 0, engine::MateStatus::Disproven, 0},            // stalemate
+        {"8/8/8/8/8/2k5/8/KQ6 w - - 0 1", 5, 1000, engine::MateStatus::Unknown, 0},           // node limit
+    };
+    int failures = 0;
+
+    for (const MateCase &mateCase : cases) {
+        engine::Game game(mateCase.fen);
+        unsigned long long moveCount = 0;
+
+        engine::clearMateTable(); // every case from an empty table
+
+        engine::MateResult result = engine::solveMate(game, mateCase.maxMoves, mateCase.maxNodes, moveCount);
+        bool passed = result.status == mateCase.status;
+
+        if (passed && result.status == engine::MateStatus::Proven) {
+            passed = result.moves == mateCase.moves && checkLine(mateCase.fen, result);
+        }
+
+        if (!passed) {
+            std::cout << "FAILED " << mateCase.fen << " mate " << mateCase.maxMoves << " : status " << result.status
+                      << ", " << result.moves << " moves, line of " << result.line.size() << " plies" << std::endl;
+            failures++;
+        }
+    }
+
+    std::cout << cases.size() - failures << "/" << cases.size() << " mate solver tests passed" << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}
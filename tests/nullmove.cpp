@@ -0,0 +1,73 @@
+#include "../src/engine/include/engine.hpp"
+#include "../src/engine/include/utils.hpp"
+#include "testutils.hpp"
+#include <string>
+#include <vector>
+
+// A null move must give the hash of the same position with the other side to move and no en passant square,
+// and undoing it must restore the position and its hash exactly
+
+// Position of the FEN after a null move : other side to move, no en passant square
+static std::string nullMoveFen(const std::string &fen) {
+    std::vector<std::string> fields = utils::split(fen);
+
+    fields[1] = (fields[1] == "w") ? "b" : "w";
+    fields[3] = "-";
+
+    return fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3] + " " + fields[4] + " " + fields[5];
+}
+
+static void checkNullMove(engine::Game &game, const std::string &fen) {
+    engine::Key hash = game.getHash();
+    std::string position = game.getPositionFEN();
+    size_t historySize = game.getHistory().size();
+
+    engine::MoveSaveState savedState = game.doNullMove();
+    engine::Game nullMoveGame(nullMoveFen(position));
+
+    check(game.getHash() != hash, fen + " : the hash did not change");
+    check(game.getHash() == nullMoveGame.getHash(), fen + " : the hash is not the one of the position after the null move");
+    check(game.isLastMoveNull(), fen + " : the null move is not in the history");
+
+    game.undoNullMove(savedState);
+
+    check(game.getHash() == hash, fen + " : the hash is not restored");
+    check(game.getPositionFEN() == position, fen + " : the position is not restored");
+    check(game.getHistory().size() == historySize, fen + " : the history is not restored");
+}
+
+int main() {
+    std::vector<std::string> fens = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3", // en passant square
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 b - - 0 1",
+    };
+
+    for (const std::string &fen : fens) {
+        engine::Game game(fen);
+        engine::Key hash = game.getHash();
+
+        checkNullMove(game, fen);
+
+        // after a double pawn push, the en passant square goes away with the null move and comes back with the undo
+        std::vector<std::string> pushes = {"e2e4", "d2d4", "c7c5", "g7g5"};
+
+        for (const std::string &push : pushes) {
+            engine::Move move = game.str2move(push);
+
+            if (move.getOriginSquare() >= 64) {
+                continue;
+            }
+
+            engine::MoveSaveState savedState = game.doMove(move);
+
+            checkNullMove(game, fen + " " + push);
+            game.undoMove(move, savedState);
+        }
+
+        check(game.getHash() == hash, fen + " : the hash is not restored after the moves");
+    }
+
+    return testsResult("null move");
+}
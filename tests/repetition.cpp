@@ -0,0 +1,80 @@
+#include "../src/engine/include/engine.hpp"
+#include "../src/engine/include/movesgeneration.hpp"
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// hasUpcomingRepetition() (cuckoo tables) against playing every legal move and looking for a repetition,
+// along random games made mostly of reversible moves so that repetitions come up
+#define GAMES        200
+#define MAX_PLIES    120
+#define SEED         1
+
+static bool bruteForceUpcomingRepetition(engine::Game &game) {
+    std::vector<engine::Move> legalMoves;
+
+    engine::generateAllLegalMoves(game, legalMoves);
+
+    for (engine::Move &move : legalMoves) {
+        engine::MoveSaveState savedState = game.doMove(move);
+        bool repeated = game.hasRepeated();
+
+        game.undoMove(move, savedState);
+
+        if (repeated) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int main() {
+    std::vector<std::string> fens = {
+        engine::startPosition,
+        "6k1/5ppp/8/8/8/8/5PPP/R5K1 w - - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", // castling rights to lose
+        "8/8/4k3/8/3NB3/8/4K3/8 w - - 0 1",
+    };
+    std::mt19937 random(SEED);
+    unsigned long long positions = 0, repetitions = 0, falsePositives = 0, missed = 0;
+
+    for (unsigned int gameNumber = 0; gameNumber < GAMES; gameNumber++) {
+        engine::Game game(fens[gameNumber % fens.size()]);
+
+        for (unsigned int ply = 0; ply < MAX_PLIES; ply++) {
+            std::vector<engine::Move> legalMoves, reversibleMoves;
+
+            engine::generateAllLegalMoves(game, legalMoves);
+
+            if (legalMoves.empty() || game.hasRepeated()) {
+                break;
+            }
+
+            bool upcoming = game.hasUpcomingRepetition();
+            bool bruteForce = bruteForceUpcomingRepetition(game);
+
+            positions++;
+            repetitions += bruteForce ? 1 : 0;
+            falsePositives += (upcoming && !bruteForce) ? 1 : 0;
+            missed += (!upcoming && bruteForce) ? 1 : 0;
+
+            for (engine::Move &move : legalMoves) {
+                if (!move.isCapture() && game.getPiece(move.getOriginSquare()).pieceType != engine::PieceType::Pawn) {
+                    reversibleMoves.push_back(move);
+                }
+            }
+
+            // an irreversible move from time to time
+            std::vector<engine::Move> &moves = (!reversibleMoves.empty() && random() % 8 != 0) ? reversibleMoves : legalMoves;
+
+            game.doMove(moves[random() % moves.size()]);
+        }
+    }
+
+    std::cout << positions << " positions, " << repetitions << " with an upcoming repetition, " << falsePositives
+              << " false positives, " << missed << " missed" << std::endl;
+
+    return (falsePositives == 0 && missed == 0 && repetitions > 0) ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+#include "../src/engine/include/engine.hpp"
+#include "../src/engine/include/evaluation.hpp"
+#include "../src/engine/include/movesgeneration.hpp"
+#include "../src/engine/include/movesordering.hpp"
+#include "../src/engine/include/utils.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Static exchange evaluation of known positions, the expected values in piece values of the evaluation
+struct SeeCase {
+    std::string fen;
+    std::string move;
+    engine::PieceType promotion; // None if the move is not a promotion
+    int expected;
+};
+
+static int value(engine::PieceType pieceType) {
+    return engine::pieceTypeValue[pieceType].first;
+}
+
+static engine::Move findMove(engine::Game &game, const SeeCase &seeCase) {
+    std::vector<engine::Move> legalMoves;
+
+    engine::generateAllLegalMoves(game, legalMoves);
+
+    for (engine::Move &move : legalMoves) {
+        std::string name = utils::caseNameFromId(move.getOriginSquare()) + utils::caseNameFromId(move.getTargetSquare());
+
+        if (name == seeCase.move && (!move.isPromotion() || move.getPromotedPiece() == seeCase.promotion)) {
+            return move;
+        }
+    }
+
+    return engine::Move();
+}
+
+int main() {
+    using engine::PieceType;
+
+    std::vector<SeeCase> cases = {
+        // undefended pawn
+        {"1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1", "e1e5", PieceType::None, value(PieceType::Pawn)},
+        // the knight takes a pawn defended by a knight, then bishop, rook and queen join in : the pawn for the knight
+        {"1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1", "d3e5", PieceType::None, value(PieceType::Pawn) - value(PieceType::Knight)},
+        // a rook taking a pawn defended by a pawn
+        {"4k3/8/3p4/4p3/8/8/4R3/4K3 w - - 0 1", "e2e5", PieceType::None, value(PieceType::Pawn) - value(PieceType::Rook)},
+        // a quiet queen move to a square attacked by a pawn
+        {"4k3/8/8/3p4/8/4Q3/8/4K3 w - - 0 1", "e3e4", PieceType::None, -value(PieceType::Queen)},
+        // a quiet move to a safe square
+        {"4k3/8/8/8/8/4Q3/8/4K3 w - - 0 1", "e3e4", PieceType::None, 0},
+        // en passant, the captured pawn is not on the target square
+        {"4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1", "e5d6", PieceType::None, value(PieceType::Pawn)},
+        // promotion on a safe square
+        {"4k3/1P6/8/8/8/8/8/4K3 w - - 0 1", "b7b8", PieceType::Queen, value(PieceType::Queen) - value(PieceType::Pawn)},
+        // x-ray : the rook behind the first one recaptures
+        {"3rk3/3r4/8/3p4/8/8/3R4/3RK3 w - - 0 1", "d2d5", PieceType::None, value(PieceType::Pawn) - value(PieceType::Rook)},
+        {"4k3/3r4/8/3p4/8/8/3R4/3RK3 w - - 0 1", "d2d5", PieceType::None, value(PieceType::Pawn)},
+    };
+    int failures = 0;
+
+    for (const SeeCase &seeCase : cases) {
+        engine::Game game(seeCase.fen);
+        engine::Move move = findMove(game, seeCase);
+        int see = engine::staticExchangeEvaluation(game, move);
+
+        if (move.getOriginSquare() >= 64 || see != seeCase.expected) {
+            std::cout << "FAILED " << seeCase.fen << " " << seeCase.move << " : " << see << " instead of " << seeCase.expected << std::endl;
+            failures++;
+        }
+    }
+
+    std::cout << cases.size() - failures << "/" << cases.size() << " SEE tests passed" << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}
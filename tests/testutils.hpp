@@ -0,0 +1,24 @@
+#ifndef __TESTUTILS_HPP__
+#define __TESTUTILS_HPP__
+
+#include <iostream>
+#include <string>
+
+// Checks of a test program : each failed one is reported, and the program fails if there is any
+static int failures = 0;
+
+static void check(bool condition, const std::string &what) {
+    if (!condition) {
+        std::cout << "FAILED " << what << std::endl;
+        failures++;
+    }
+}
+
+// Summary line of the tests, and exit status of the program
+static int testsResult(const std::string &tests) {
+    std::cout << tests << (failures == 0 ? " tests passed" : " tests failed") << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,109 @@
+#include "../src/engine/include/search.hpp"
+#include "../src/engine/include/transpositiontable.hpp"
+#include "testutils.hpp"
+#include <string>
+#include <vector>
+
+// Mate scores are stored relative to the position and read back relative to the root : a mate stored at one ply
+// and probed at another must keep its distance from the position
+
+// Black mates in 3 (5 plies)
+static const std::string MATE_FEN = "r1b1kb1r/pppp1ppp/5q2/4n3/3KP3/2N3PN/PPP4P/R1BQ1B1R b kq - 0 1";
+static const unsigned int MATE_PLIES = 5;
+static const unsigned int SEARCH_DEPTH = 8; // iterative deepening stops once it finds the mate
+static const unsigned int SHALLOW_DEPTH = 2;
+
+static engine::MoveValuation searchToDepth(engine::Game &game, unsigned int depth) {
+    engine::SearchLimits limits;
+    unsigned long long moveCount = 0;
+    unsigned int completedDepth;
+
+    limits.depth = depth;
+
+    return engine::iterativeDeepening(game, limits, moveCount, completedDepth);
+}
+
+// The positions of the mating line with black to move are searched again at ply 0, once the whole line was searched
+// from the first one : searches too shallow to find the mate by themselves get it from the entries stored at deeper
+// plies, and it must be as far as the mate found by a full search from an empty table
+static void checkMateLine() {
+    engine::TTable &ttable = engine::getTranspositionTable();
+    engine::Game game(MATE_FEN);
+    std::vector<engine::Move> line;
+
+    ttable.openPrivate();
+
+    engine::MoveValuation best = searchToDepth(game, SEARCH_DEPTH);
+
+    check(best.second == engine::MAX_SCORE - (int)MATE_PLIES, "mate in " + std::to_string(MATE_PLIES) + " plies not found : " + std::to_string(best.second));
+
+    engine::principalVariation(game, best.first, MATE_PLIES, line);
+    check(line.size() >= MATE_PLIES - 1, "mating line of " + std::to_string(line.size()) + " moves"); // the mating move isn't needed
+
+    for (unsigned int ply = 2; ply < MATE_PLIES && ply <= line.size(); ply += 2) {
+        engine::Game position(MATE_FEN);
+        int expected = engine::MAX_SCORE - (int)(MATE_PLIES - ply);
+
+        for (unsigned int i = 0; i < ply; i++) {
+            position.doMove(line[i]);
+        }
+
+        ttable.openPrivate();
+
+        int fresh = searchToDepth(position, SEARCH_DEPTH).second;
+
+        ttable.openPrivate();
+        searchToDepth(game, SEARCH_DEPTH);
+
+        int transposed = searchToDepth(position, SHALLOW_DEPTH).second;
+
+        check(fresh == expected, "mate after " + std::to_string(ply) + " plies searched alone : " + std::to_string(fresh));
+        check(transposed == expected, "mate after " + std::to_string(ply) + " plies found through the table : " + std::to_string(transposed));
+    }
+}
+
+int main() {
+    std::vector<int> scores = {0, 35, -35, engine::MATE_BOUND - 1, -engine::MATE_BOUND + 1};
+    engine::TTable &ttable = engine::getTranspositionTable();
+    engine::Key key = 0x9e3779b97f4a7c15ULL;
+    engine::Move move(12, 28, M_NONE, {engine::PieceType::None, engine::Color::Black});
+
+    for (unsigned int distance = 1; distance <= 2 * engine::MAX_DEPTH; distance += 7) {
+        scores.push_back(engine::MAX_SCORE - (int)distance);  // mating
+        scores.push_back(engine::MIN_SCORE + (int)distance);  // mated
+    }
+
+    for (int score : scores) {
+        for (unsigned int ply = 0; ply <= 2 * engine::MAX_DEPTH - 1; ply++) {
+            bool mate = score >= engine::MATE_BOUND || score <= -engine::MATE_BOUND;
+
+            // a mate <score> from the root found at <ply> is a mate closer by <ply> from the position
+            if (mate && engine::MAX_SCORE - std::abs(score) < (int)ply) {
+                continue;
+            }
+
+            int stored = engine::scoreToTTable(score, ply);
+
+            check(engine::scoreFromTTable(stored, ply) == score, "round trip of " + std::to_string(score) + " at ply " + std::to_string(ply));
+            check(mate || stored == score, "score " + std::to_string(score) + " changed at ply " + std::to_string(ply));
+
+            // the same position probed 2 plies deeper : the mate is 2 plies further from the root
+            int deeper = engine::scoreFromTTable(stored, ply + 2);
+            int expected = !mate ? score : (score > 0 ? score - 2 : score + 2);
+
+            check(deeper == expected, "score " + std::to_string(score) + " stored at ply " + std::to_string(ply) + " read 2 plies deeper");
+
+            // through the table, with the window converted the same way
+            ttable.addEntry(key, move, 5, stored, engine::scoreToTTable(engine::MIN_SCORE, ply), engine::scoreToTTable(engine::MAX_SCORE, ply));
+
+            engine::TTEntry entry = ttable.getEntry(key);
+
+            check(entry.hash == key && entry.entryType == engine::TTEntryType::Exact, "entry of " + std::to_string(score) + " not found exact");
+            check(engine::scoreFromTTable(entry.valuation, ply) == score, "table round trip of " + std::to_string(score) + " at ply " + std::to_string(ply));
+        }
+    }
+
+    checkMateLine();
+
+    return testsResult("TT mate score");
+}